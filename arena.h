@@ -0,0 +1,134 @@
+/*
+ * Bump allocator that places objects contiguously in allocation order.
+ *
+ * Memory is taken from the system in blocks and only returned when the arena
+ * is destroyed. The blocks come from malloc(), or are mapped on their own in
+ * transparent huge pages (2 MiB) or in 4 KiB pages only; with one_per_page,
+ * every allocation also starts a page of its own. Objects made with create()
+ * are destroyed along with the arena; objects placed with allocate(), e.g.
+ * through ArenaAllocator by std::allocate_shared, are destroyed by their
+ * owner.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <new>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+class Arena {
+public:
+    enum class Pages { heap, huge, small, one_per_page };
+
+    static constexpr size_t page_size = 4 << 10;
+    static constexpr size_t huge_page_size = 2 << 20;
+
+    explicit Arena(Pages pages = Pages::heap, size_t block_size = 1 << 20) : pages(pages), block_size(block_size) {
+        if (pages == Pages::huge) this->block_size = std::max(block_size, huge_page_size);
+        if (pages == Pages::one_per_page) this->block_size = std::max(block_size, size_t(64) << 20);
+    }
+
+    ~Arena() {
+        for (auto it = objects.rbegin(); it != objects.rend(); ++it) it->destroy(it->p);
+        for (auto& b: blocks) {
+#if defined(__linux__)
+            if (pages != Pages::heap) {
+                munmap(b.p, b.size);
+                continue;
+            }
+#endif
+            std::free(b.p);
+        }
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t align) {
+        if (pages == Pages::one_per_page) align = std::max(align, page_size);
+        auto p = (uintptr_t(next) + align - 1) & ~uintptr_t(align - 1);
+        if (!next || p + size > uintptr_t(end)) {
+            auto b = new_block(std::max(size + align, block_size));
+            next = b.p;
+            end = b.p + b.size;
+            p = (uintptr_t(next) + align - 1) & ~uintptr_t(align - 1);
+        }
+        next = reinterpret_cast<char*>(p + size);
+        return reinterpret_cast<void*>(p);
+    }
+
+    template<class T, class... Args>
+    T* create(Args&&... args) {
+        auto p = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        objects.push_back({ p, [](void* p) { static_cast<T*>(p)->~T(); } });
+        return p;
+    }
+
+private:
+    struct Object {
+        void* p;
+        void (*destroy)(void*);
+    };
+
+    struct Block {
+        char* p;
+        size_t size;
+    };
+
+    Block new_block(size_t bytes) {
+#if defined(__linux__)
+        if (pages != Pages::heap) {
+            // Huge pages need a block aligned to them, so map more and unmap
+            // what is around the aligned block.
+            auto align = pages == Pages::huge ? huge_page_size : page_size;
+            bytes = (bytes + align - 1) & ~(align - 1);
+            auto mapped = mmap(nullptr, bytes + align - page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mapped == MAP_FAILED) throw std::bad_alloc();
+            auto m = static_cast<char*>(mapped);
+            auto b = reinterpret_cast<char*>((uintptr_t(m) + align - 1) & ~uintptr_t(align - 1));
+            if (b > m) munmap(m, b - m);
+            if (m + bytes + align - page_size > b + bytes) munmap(b + bytes, m + bytes + align - page_size - (b + bytes));
+            madvise(b, bytes, pages == Pages::huge ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+            blocks.push_back({ b, bytes });
+            return blocks.back();
+        }
+#endif
+        auto b = static_cast<char*>(std::malloc(bytes));
+        if (!b) throw std::bad_alloc();
+        blocks.push_back({ b, bytes });
+        return blocks.back();
+    }
+
+    Pages pages;
+    size_t block_size;
+    char* next { nullptr };
+    char* end { nullptr };
+    std::vector<Block> blocks;
+    std::vector<Object> objects;
+};
+
+// Standard allocator on top of an Arena, for std::allocate_shared.
+template<class T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    Arena* arena;
+
+    explicit ArenaAllocator(Arena& arena) : arena(&arena) {}
+    template<class U> ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(arena->allocate(count * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {} // freed with the arena
+
+    template<class U> bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+};
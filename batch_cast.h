@@ -0,0 +1,139 @@
+/*
+ * Batched interval_cast: classifies a whole span of objects against one
+ * target class in a single call.
+ *
+ * With AVX2, four type IDs are fetched per gather instruction and checked
+ * against the target's interval with one vector compare. The check is
+ * dispatched at runtime, so the binary does not need to be compiled for
+ * AVX2; without it (or on other architectures) a scalar loop is used.
+ *
+ * The type ID has to live at the same offset in every From object, i.e.
+ * interval::Base must not be a virtual base of From.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+#include "interval_cast.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define INTERVAL_BATCH_AVX2 1
+#endif
+
+namespace interval {
+
+template<class To, class From>
+To adjust(From* p)
+{
+    if constexpr (requires { static_cast<To>(p); }) return static_cast<To>(p);
+    else return dynamic_cast<To>(p);
+}
+
+// Offset of the type ID from the start of a From object, taken from the
+// first object in `in`. False if there is none.
+template<class From>
+bool type_id_offset(std::span<From* const> in, std::ptrdiff_t& offset)
+{
+    for (auto p: in) {
+        if (!p) continue;
+        offset = reinterpret_cast<const char*>(p->interval_type_id_address()) - reinterpret_cast<const char*>(p);
+        return true;
+    }
+    return false;
+}
+
+#if defined(INTERVAL_BATCH_AVX2)
+inline bool have_avx2()
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+// Bit i of the result is set if the object at ptrs[i] (i < 4) has a type ID
+// in r. Null pointers are not dereferenced and never match.
+__attribute__((target("avx2")))
+inline unsigned int match4(const void* const* ptrs, std::ptrdiff_t offset, Range r)
+{
+    auto p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptrs));
+    auto non_null = _mm256_xor_si256(_mm256_cmpeq_epi64(p, _mm256_setzero_si256()), _mm256_set1_epi64x(-1));
+    auto addresses = _mm256_add_epi64(p, _mm256_set1_epi64x(offset));
+    // Null lanes keep first - 1, which is outside of r.
+    auto ids = _mm256_mask_i64gather_epi32(
+            _mm_set1_epi32(r.first - 1), nullptr, addresses,
+            _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(non_null, _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7))),
+            1);
+    auto x = _mm_sub_epi32(ids, _mm_set1_epi32(r.first));
+    auto in_range = _mm_cmpeq_epi32(_mm_min_epu32(x, _mm_set1_epi32(r.last - r.first)), x);
+    return _mm_movemask_ps(_mm_castsi128_ps(in_range));
+}
+#endif
+
+} // namespace interval
+
+// Writes the objects of `in` that are To (or derived from it), converted to
+// To, to `out`, which must have room for in.size() pointers. Returns the
+// number of objects written.
+template<class To, class From>
+size_t interval_cast_batch(std::span<From* const> in, To* out)
+{
+    using T = std::remove_cv_t<std::remove_pointer_t<To>>;
+    constexpr interval::Range r = interval::range_of<T, typename From::interval_tree>;
+    if constexpr (r.empty()) return 0;
+
+    size_t k = 0, i = 0;
+#if defined(INTERVAL_BATCH_AVX2)
+    std::ptrdiff_t offset;
+    if (interval::have_avx2() && interval::type_id_offset(in, offset)) {
+        auto ptrs = reinterpret_cast<const void* const*>(in.data());
+        for (; i + 4 <= in.size(); i += 4) {
+            for (auto m = interval::match4(ptrs + i, offset, r); m; m &= m - 1)
+                out[k++] = interval::adjust<To>(in[i + __builtin_ctz(m)]);
+        }
+    }
+#endif
+    for (; i < in.size(); i++) {
+        auto p = in[i];
+        if (p && r.contains(p->interval_type_id())) out[k++] = interval::adjust<To>(p);
+    }
+    return k;
+}
+
+// Sets bit i % 64 of mask[i / 64] if in[i] is To (or derived from it), and
+// clears it otherwise. Returns the number of set bits.
+template<class To, class From>
+size_t interval_cast_mask(std::span<From* const> in, uint64_t* mask)
+{
+    using T = std::remove_cv_t<std::remove_pointer_t<To>>;
+    constexpr interval::Range r = interval::range_of<T, typename From::interval_tree>;
+
+    for (size_t w = 0; w < (in.size() + 63) / 64; w++) mask[w] = 0;
+    if constexpr (r.empty()) return 0;
+
+    size_t k = 0, i = 0;
+#if defined(INTERVAL_BATCH_AVX2)
+    std::ptrdiff_t offset;
+    if (interval::have_avx2() && interval::type_id_offset(in, offset)) {
+        auto ptrs = reinterpret_cast<const void* const*>(in.data());
+        for (; i + 4 <= in.size(); i += 4) {
+            uint64_t m = interval::match4(ptrs + i, offset, r);
+            mask[i / 64] |= m << (i % 64);
+            k += __builtin_popcountll(m);
+        }
+    }
+#endif
+    for (; i < in.size(); i++) {
+        auto p = in[i];
+        if (p && r.contains(p->interval_type_id())) {
+            mask[i / 64] |= uint64_t(1) << (i % 64);
+            k++;
+        }
+    }
+    return k;
+}
@@ -0,0 +1,745 @@
+/*
+ * Declarations shared by the translation units of the benchmark: the class
+ * hierarchies, the data sets, the cast kernels and the measurement helpers.
+ * Each suite (casts, scaling, dispatch, registry, construction) is compiled
+ * on its own and instantiated for both pointer types, std::shared_ptr<A> and
+ * A*, so that the suites build in parallel.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <typeindex>
+#include <utility>
+#include <vector>
+
+#include "priori/priori.h"
+#include "KCL/KCL_RTTI.h"
+#include "interval_cast.h"
+#include "measurement.h"
+#include "perf_counters.h"
+#include "arena.h"
+#include "hierarchy_generator.h"
+#include "inline_cast_cache.h"
+#include "results.h"
+#include "shared_ptr_cast.h"
+
+enum class Hierarchy { deep, shallow, balanced, chain, chain_multiple, chain_virtual, binary, wide, comb_100, comb_200, comb_400 };
+enum class SortOrder { aligned, shuffled, strided };
+enum class Distribution { uniform, zipf };
+enum class Implementation { dynamic, priori, kcl, interval, inline_cache_1, inline_cache_4 };
+enum class Layout { shared_ptr, arena_shared_ptr, arena, pools };
+enum class Placement { heap, huge, small, page, scattered };
+enum class Mode { casts, scaling, dispatch, construction, startup, registry };
+
+extern int max_num_ops;
+
+const auto num_usecs_per_sec = 1'000'000;
+const auto num_nsecs_per_sec = 1'000'000'000.0;
+
+// The workload, see usage().
+extern uint64_t n; // number of iterations
+extern unsigned int num_warmup_passes; // untimed passes before each measurement
+extern unsigned int num_samples;       // timed passes per measurement
+
+// Of the classes in the mixed data sets.
+extern Distribution distribution;
+extern double zipf_exponent;
+
+// Where the objects are placed in memory, in the current pass over the
+// layouts.
+extern Placement placement;
+
+// What to run.
+extern std::vector<Hierarchy> hierarchies;
+extern std::vector<Implementation> implementations;
+extern bool batched; // interval_cast_batch and interval_cast_mask
+extern bool bucketed; // TypeBuckets::for_each
+extern bool pointer_casts; // shared_ptr and borrowed casts, in the shared_ptr layouts
+
+struct A;
+namespace deep     { struct B; struct C; struct D; struct E; struct F; struct G; struct H; }
+namespace shallow  { struct B; struct C; struct D; struct E; struct F; struct G; struct H; }
+namespace balanced { struct B; struct C; struct D; struct E; struct F; struct G; struct H; }
+
+// Synthetic hierarchies below A. Class I of a shape is Node<shape, I>, see
+// hierarchy_generator.h. Compile time grows with the number of classes.
+namespace generated {
+    inline constexpr gen::Shape chain          { 10, 1, gen::Inheritance::single };   // 11 classes
+    inline constexpr gen::Shape chain_multiple { 10, 1, gen::Inheritance::multiple }; // 11 classes
+    inline constexpr gen::Shape chain_virtual  { 10, 1, gen::Inheritance::virtual_ }; // 11 classes
+    inline constexpr gen::Shape binary         {  5, 2, gen::Inheritance::single };   // 63 classes
+    inline constexpr gen::Shape wide           {  2, 8, gen::Inheritance::single };   // 73 classes
+    // Of the same depth, with about 100, 200 and 400 classes.
+    inline constexpr gen::Shape comb_100       { 12,  8, gen::Inheritance::single, true }; //  97 classes
+    inline constexpr gen::Shape comb_200       { 12, 17, gen::Inheritance::single, true }; // 205 classes
+    inline constexpr gen::Shape comb_400       { 12, 33, gen::Inheritance::single, true }; // 397 classes
+
+    template<gen::Shape S, uint32_t I> struct Node;
+
+    // Without commas, for the KCL macros.
+    template<uint32_t I> using Chain = Node<chain, I>;
+    template<uint32_t I> using ChainMultiple = Node<chain_multiple, I>;
+    template<uint32_t I> using ChainVirtual = Node<chain_virtual, I>;
+    template<uint32_t I> using Binary = Node<binary, I>;
+    template<uint32_t I> using Wide = Node<wide, I>;
+    template<uint32_t I> using Comb100 = Node<comb_100, I>;
+    template<uint32_t I> using Comb200 = Node<comb_200, I>;
+    template<uint32_t I> using Comb400 = Node<comb_400, I>;
+}
+
+// Compile-time description of all hierarchies for interval_cast.
+using IntervalTree = interval::Node<A,
+    interval::Node<deep::B,
+        interval::Node<deep::C,
+            interval::Node<deep::D,
+                interval::Node<deep::E,
+                    interval::Node<deep::F,
+                        interval::Node<deep::G,
+                            interval::Node<deep::H>>>>>>>,
+    interval::Node<shallow::B>,
+    interval::Node<shallow::C>,
+    interval::Node<shallow::D>,
+    interval::Node<shallow::E>,
+    interval::Node<shallow::F>,
+    interval::Node<shallow::G>,
+    interval::Node<shallow::H>,
+    interval::Node<balanced::B,
+        interval::Node<balanced::C>,
+        interval::Node<balanced::D>>,
+    interval::Node<balanced::E,
+        interval::Node<balanced::F>,
+        interval::Node<balanced::G>,
+        interval::Node<balanced::H>>,
+    gen::IntervalSubtree<generated::chain, generated::Node>,
+    gen::IntervalSubtree<generated::chain_multiple, generated::Node>,
+    gen::IntervalSubtree<generated::chain_virtual, generated::Node>,
+    gen::IntervalSubtree<generated::binary, generated::Node>,
+    gen::IntervalSubtree<generated::wide, generated::Node>,
+    gen::IntervalSubtree<generated::comb_100, generated::Node>,
+    gen::IntervalSubtree<generated::comb_200, generated::Node>,
+    gen::IntervalSubtree<generated::comb_400, generated::Node>>;
+
+// The hand-written classes, for the visitor of the dispatch suite.
+#define HAND_WRITTEN_CLASSES(X) \
+    X(A) \
+    X(deep::B) X(deep::C) X(deep::D) X(deep::E) X(deep::F) X(deep::G) X(deep::H) \
+    X(shallow::B) X(shallow::C) X(shallow::D) X(shallow::E) X(shallow::F) X(shallow::G) X(shallow::H) \
+    X(balanced::B) X(balanced::C) X(balanced::D) X(balanced::E) X(balanced::F) X(balanced::G) X(balanced::H)
+
+struct Visitor {
+#define DECLARE_VISIT(T) virtual void visit(T&) = 0;
+    HAND_WRITTEN_CLASSES(DECLARE_VISIT)
+#undef DECLARE_VISIT
+};
+
+// Double dispatch: each class calls the visit() overload for itself.
+#define VISITABLE() void accept(Visitor& v) override { v.visit(*this); }
+
+struct A : priori::Base, interval::Base<IntervalTree> {
+    KCL_RTTI_IMPL();
+    virtual void accept(Visitor& v) { v.visit(*this); }
+    uint64_t get() { return x; };
+    uint64_t x { 1 };
+};
+KCL_RTTI_REGISTER(A);
+
+namespace deep {
+    struct B : A { KCL_RTTI_IMPL(); VISITABLE(); B() { priori(this); interval_id(this); } };
+    struct C : B { KCL_RTTI_IMPL(); VISITABLE(); C() { priori(this); interval_id(this); } };
+    struct D : C { KCL_RTTI_IMPL(); VISITABLE(); D() { priori(this); interval_id(this); } };
+    struct E : D { KCL_RTTI_IMPL(); VISITABLE(); E() { priori(this); interval_id(this); } };
+    struct F : E { KCL_RTTI_IMPL(); VISITABLE(); F() { priori(this); interval_id(this); } };
+    struct G : F { KCL_RTTI_IMPL(); VISITABLE(); G() { priori(this); interval_id(this); } };
+    struct H : G { KCL_RTTI_IMPL(); VISITABLE(); H() { priori(this); interval_id(this); } };
+}
+KCL_RTTI_REGISTER(deep::B, A);
+KCL_RTTI_REGISTER(deep::C, deep::B);
+KCL_RTTI_REGISTER(deep::D, deep::C);
+KCL_RTTI_REGISTER(deep::E, deep::D);
+KCL_RTTI_REGISTER(deep::F, deep::E);
+KCL_RTTI_REGISTER(deep::G, deep::F);
+KCL_RTTI_REGISTER(deep::H, deep::G);
+
+namespace shallow {
+    struct B : A { KCL_RTTI_IMPL(); VISITABLE(); B() { priori(this); interval_id(this); } };
+    struct C : A { KCL_RTTI_IMPL(); VISITABLE(); C() { priori(this); interval_id(this); } };
+    struct D : A { KCL_RTTI_IMPL(); VISITABLE(); D() { priori(this); interval_id(this); } };
+    struct E : A { KCL_RTTI_IMPL(); VISITABLE(); E() { priori(this); interval_id(this); } };
+    struct F : A { KCL_RTTI_IMPL(); VISITABLE(); F() { priori(this); interval_id(this); } };
+    struct G : A { KCL_RTTI_IMPL(); VISITABLE(); G() { priori(this); interval_id(this); } };
+    struct H : A { KCL_RTTI_IMPL(); VISITABLE(); H() { priori(this); interval_id(this); } };
+}
+KCL_RTTI_REGISTER(shallow::B, A);
+KCL_RTTI_REGISTER(shallow::C, A);
+KCL_RTTI_REGISTER(shallow::D, A);
+KCL_RTTI_REGISTER(shallow::E, A);
+KCL_RTTI_REGISTER(shallow::F, A);
+KCL_RTTI_REGISTER(shallow::G, A);
+KCL_RTTI_REGISTER(shallow::H, A);
+
+namespace balanced {
+    struct B : A { KCL_RTTI_IMPL(); VISITABLE(); B() { priori(this); interval_id(this); } };
+    struct C : B { KCL_RTTI_IMPL(); VISITABLE(); C() { priori(this); interval_id(this); } };
+    struct D : B { KCL_RTTI_IMPL(); VISITABLE(); D() { priori(this); interval_id(this); } };
+
+    struct E : A { KCL_RTTI_IMPL(); VISITABLE(); E() { priori(this); interval_id(this); } };
+    struct F : E { KCL_RTTI_IMPL(); VISITABLE(); F() { priori(this); interval_id(this); } };
+    struct G : E { KCL_RTTI_IMPL(); VISITABLE(); G() { priori(this); interval_id(this); } };
+    struct H : E { KCL_RTTI_IMPL(); VISITABLE(); H() { priori(this); interval_id(this); } };
+}
+KCL_RTTI_REGISTER(balanced::B, A);
+KCL_RTTI_REGISTER(balanced::C, balanced::B);
+KCL_RTTI_REGISTER(balanced::D, balanced::B);
+KCL_RTTI_REGISTER(balanced::E, A);
+KCL_RTTI_REGISTER(balanced::F, balanced::E);
+KCL_RTTI_REGISTER(balanced::G, balanced::E);
+KCL_RTTI_REGISTER(balanced::H, balanced::E);
+
+namespace generated {
+    template<gen::Shape S, uint32_t I>
+    using ParentOf = std::conditional_t<I == 0, A, Node<S, gen::parent(S, I)>>;
+
+    // The other base class with multiple inheritance. It comes first, so
+    // that the A subobject is not at the start of the object.
+    template<uint32_t I>
+    struct Mixin {
+        virtual ~Mixin() = default;
+        uint64_t y { I };
+    };
+
+    template<gen::Shape S, uint32_t I> requires (S.inheritance == gen::Inheritance::single)
+    struct Node<S, I> : ParentOf<S, I> {
+        using Parent = ParentOf<S, I>;
+        KCL_RTTI_IMPL(); Node() { this->priori(this); this->interval_id(this); }
+    };
+
+    template<gen::Shape S, uint32_t I> requires (S.inheritance == gen::Inheritance::multiple)
+    struct Node<S, I> : Mixin<I>, ParentOf<S, I> {
+        using Parent = ParentOf<S, I>;
+        KCL_RTTI_IMPL(); Node() { this->priori(this); this->interval_id(this); }
+    };
+
+    // Priori and KCL do not support virtual bases, so these classes are
+    // only registered with interval_cast.
+    template<gen::Shape S, uint32_t I> requires (S.inheritance == gen::Inheritance::virtual_)
+    struct Node<S, I> : virtual ParentOf<S, I> {
+        using Parent = ParentOf<S, I>;
+        Node() { this->interval_id(this); }
+    };
+}
+
+// Registers the classes of shape `shape`, aliased as generated::Alias<I>,
+// with KCL. The number of classes is given as its decimal digits, see
+// GEN_REPEAT(), and checked against the shape.
+#define REGISTER_GENERATED_CLASS(Alias, i) KCL_RTTI_REGISTER(generated::Alias<i>, generated::Alias<i>::Parent);
+#define REGISTER_GENERATED(Alias, shape, h, t, u) \
+    static_assert(gen::size(generated::shape) == (h) * 100 + (t) * 10 + (u), "wrong size of generated::" #shape); \
+    GEN_REPEAT(REGISTER_GENERATED_CLASS, Alias, h, t, u)
+
+REGISTER_GENERATED(Chain, chain, 0, 1, 1)
+REGISTER_GENERATED(ChainMultiple, chain_multiple, 0, 1, 1)
+REGISTER_GENERATED(Binary, binary, 0, 6, 3)
+REGISTER_GENERATED(Wide, wide, 0, 7, 3)
+REGISTER_GENERATED(Comb100, comb_100, 0, 9, 7)
+REGISTER_GENERATED(Comb200, comb_200, 2, 0, 5)
+REGISTER_GENERATED(Comb400, comb_400, 3, 9, 7)
+
+// Whether priori_cast and kcl_dynamic_cast can cast to T.
+template<class T> constexpr bool registered_with_priori_and_kcl = true;
+template<uint32_t I> constexpr bool registered_with_priori_and_kcl<generated::ChainVirtual<I>> = false;
+
+// Same interface as A, but not related.
+struct Z {
+    KCL_RTTI_IMPL();
+    uint64_t get() { return 1; };
+};
+KCL_RTTI_REGISTER(Z);
+
+void draw_bar(float percent, std::string s = "-");
+
+// Width of the statistics columns printed by run(), so that the AVG line
+// can align its bar with the others.
+extern int stats_columns;
+
+// Hardware counters of the main thread, reported per cast.
+extern perf::Counters counters;
+
+// What run() is measuring, all but the target. Nothing is recorded while
+// current.run is empty.
+extern results::Record current;
+extern std::vector<results::Record> records;
+
+uint64_t run(std::string label, std::function<uint64_t()> benchmark);
+// Prints the average of the throughputs of `count` measured targets.
+void print_average(float num, unsigned int count);
+
+const char* hierarchy_name(Hierarchy h);
+const char* hierarchy_section(Hierarchy h);
+const char* layout_name(Layout l);
+const char* layout_description(Layout l);
+const char* placement_name(Placement p);
+const char* placement_description(Placement p);
+bool applies(Placement p, Layout l);
+Arena::Pages arena_pages(Placement p);
+
+// The data sets of one layout. Ptr is std::shared_ptr<A> for the shared_ptr
+// layouts and A* for the others. The arenas take their pages as given by the
+// current placement.
+template<class Ptr>
+struct DataSets {
+    explicit DataSets(Layout layout) : layout(layout), arena(arena_pages(placement)) {}
+
+    Layout layout;
+    Arena arena;
+    std::map<std::type_index, Arena> pools;
+
+    // Declared after the arenas, so that they are destroyed before them.
+    std::vector<Ptr> vec_deep_successful;
+    std::vector<Ptr> vec_deep_fails;
+
+    std::vector<Ptr> vec_shallow_successful;
+    std::vector<Ptr> vec_shallow_fails;
+
+    std::vector<Ptr> vec_deep_mixed;
+    std::vector<Ptr> vec_shallow_mixed;
+    std::vector<Ptr> vec_balanced_mixed;
+
+    std::vector<Ptr> vec_chain_mixed;
+    std::vector<Ptr> vec_chain_multiple_mixed;
+    std::vector<Ptr> vec_chain_virtual_mixed;
+    std::vector<Ptr> vec_binary_mixed;
+    std::vector<Ptr> vec_wide_mixed;
+    std::vector<Ptr> vec_comb_100_mixed;
+    std::vector<Ptr> vec_comb_200_mixed;
+    std::vector<Ptr> vec_comb_400_mixed;
+
+    struct DataSet {
+        std::vector<Ptr>* v;
+        Hierarchy h;
+        const char* name;
+        unsigned int from, width; // classes drawn, see generate_data()
+        const char* heading;
+    };
+
+    std::vector<DataSet> all() {
+        return {
+            { &vec_deep_successful, Hierarchy::deep, "successful", 6, 0, "Cast type: Mostly successful (cast from class G)" },
+            { &vec_deep_fails, Hierarchy::deep, "fails", 1, 0, "Cast type: Mostly failed (cast from class B)" },
+            { &vec_deep_mixed, Hierarchy::deep, "mixed", 0, 6, "Cast type: Mixed (cast from random classes)" },
+            { &vec_shallow_successful, Hierarchy::shallow, "successful", 6, 0, "Cast type: Mostly successful (cast from class G)" },
+            { &vec_shallow_fails, Hierarchy::shallow, "fails", 1, 0, "Cast type: Mostly failed (cast from class B)" },
+            { &vec_shallow_mixed, Hierarchy::shallow, "mixed", 0, 6, "Cast type: Mixed (cast from random classes)" },
+            { &vec_balanced_mixed, Hierarchy::balanced, "mixed", 0, 6, "Cast type: Mixed (cast from random classes)" },
+            { &vec_chain_mixed, Hierarchy::chain, "mixed", 0, gen::size(generated::chain) - 1,
+                "Chain of depth 10, single inheritance (cast from random classes)" },
+            { &vec_chain_multiple_mixed, Hierarchy::chain_multiple, "mixed", 0, gen::size(generated::chain_multiple) - 1,
+                "Chain of depth 10, multiple inheritance (cast from random classes)" },
+            { &vec_chain_virtual_mixed, Hierarchy::chain_virtual, "mixed", 0, gen::size(generated::chain_virtual) - 1,
+                "Chain of depth 10, virtual inheritance (cast from random classes)" },
+            { &vec_binary_mixed, Hierarchy::binary, "mixed", 0, gen::size(generated::binary) - 1,
+                "Binary tree of depth 5, 63 classes (cast from random classes)" },
+            { &vec_wide_mixed, Hierarchy::wide, "mixed", 0, gen::size(generated::wide) - 1,
+                "Fan-out 8, depth 2, 73 classes (cast from random classes)" },
+            { &vec_comb_100_mixed, Hierarchy::comb_100, "mixed", 0, gen::size(generated::comb_100) - 1,
+                "Comb of depth 12, 97 classes (cast from random classes)" },
+            { &vec_comb_200_mixed, Hierarchy::comb_200, "mixed", 0, gen::size(generated::comb_200) - 1,
+                "Comb of depth 12, 205 classes (cast from random classes)" },
+            { &vec_comb_400_mixed, Hierarchy::comb_400, "mixed", 0, gen::size(generated::comb_400) - 1,
+                "Comb of depth 12, 397 classes (cast from random classes)" },
+        };
+    }
+
+    template<class T>
+    Ptr make() {
+        if constexpr (std::is_same_v<Ptr, std::shared_ptr<A>>) {
+            if (layout == Layout::arena_shared_ptr) return std::allocate_shared<T>(ArenaAllocator<T>(arena));
+            return std::make_shared<T>();
+        } else {
+            if (layout == Layout::pools) return pools.try_emplace(typeid(T), arena_pages(placement)).first->second.template create<T>();
+            return arena.create<T>();
+        }
+    }
+};
+
+inline A* ptr(const std::shared_ptr<A>& e) { return e.get(); }
+inline A* ptr(A* e) { return e; }
+
+// Fills v with objects of the classes from, ..., from + width of hierarchy h,
+// see data_sets.cpp.
+template<class Ptr>
+void generate_data(DataSets<Ptr>& data, std::vector<Ptr>& v, Hierarchy h, unsigned int from = 7, unsigned int width = 0);
+
+// Makes an object of class i of a generated hierarchy. With hundreds of
+// classes, this is what takes longest to compile, so it is instantiated in
+// translation units of its own, see generated_data.h.
+template<gen::Shape S, class Ptr>
+Ptr make_generated(DataSets<Ptr>& data, uint32_t i);
+
+// Cast kernels shared by all suites.
+
+// The inline cache of the cast site for To in cast<>, per thread.
+template<unsigned int Ways, class To>
+InlineCastCache<To*, Ways>& inline_cache()
+{
+    static thread_local InlineCastCache<To*, Ways> cache;
+    return cache;
+}
+
+template<Implementation I, class To>
+To* cast(A* p)
+{
+    if constexpr (I == Implementation::dynamic) return dynamic_cast<To*>(p);
+    else if constexpr (I == Implementation::priori) return priori_cast<To*>(p);
+    else if constexpr (I == Implementation::kcl) return kcl_dynamic_cast<To*>(p);
+    else if constexpr (I == Implementation::interval) return interval_cast<To*>(p);
+    else if constexpr (I == Implementation::inline_cache_1) return inline_cache<1, To>().cast(p);
+    else return inline_cache<4, To>().cast(p);
+}
+
+const char* implementation_name(Implementation i);
+const char* implementation_option(Implementation i);
+bool selected(Implementation i);
+bool pointer_cast_selected(Implementation i);
+
+template<class... Ts> struct TypeList {};
+
+// The cast targets B..H and Z of each hierarchy, as averaged by print_average().
+using DeepTargets = TypeList<deep::B, deep::C, deep::D, deep::E, deep::F, deep::G, deep::H, Z>;
+using ShallowTargets = TypeList<shallow::B, shallow::C, shallow::D, shallow::E, shallow::F, shallow::G, shallow::H, Z>;
+using BalancedTargets = TypeList<balanced::B, balanced::C, balanced::D, balanced::E, balanced::F, balanced::G, balanced::H, Z>;
+
+// Type ID of class T for interval_cast.
+template<class T>
+constexpr uint32_t id_of = interval::range_of<T, IntervalTree>.first;
+
+// The classes of each hand-written hierarchy, in the order in which an
+// if-chain has to test them: subclasses before their bases, A last.
+using DeepClasses = TypeList<deep::H, deep::G, deep::F, deep::E, deep::D, deep::C, deep::B, A>;
+using ShallowClasses = TypeList<shallow::B, shallow::C, shallow::D, shallow::E, shallow::F, shallow::G, shallow::H, A>;
+using BalancedClasses = TypeList<balanced::C, balanced::D, balanced::B, balanced::F, balanced::G, balanced::H, balanced::E, A>;
+
+// Whether implementation I can cast to all of the targets.
+template<Implementation I, class... To>
+constexpr bool available(TypeList<To...>)
+{
+    return (I != Implementation::priori && I != Implementation::kcl) || (registered_with_priori_and_kcl<To> && ...);
+}
+
+// In the generated hierarchies, the leftmost class at every depth, and Z.
+template<gen::Shape S, uint32_t... K>
+TypeList<generated::Node<S, K>..., Z> depth_targets(std::integer_sequence<uint32_t, K...>);
+
+template<gen::Shape S>
+using GeneratedTargets = decltype(depth_targets<S>(std::make_integer_sequence<uint32_t, S.depth + 1>()));
+
+// All classes of a generated hierarchy.
+template<gen::Shape S, uint32_t... I>
+TypeList<generated::Node<S, I>...> all_classes(std::integer_sequence<uint32_t, I...>);
+
+template<gen::Shape S>
+using GeneratedClasses = decltype(all_classes<S>(std::make_integer_sequence<uint32_t, gen::size(S)>()));
+
+// Calls f with the TypeList of the cast targets of hierarchy h.
+template<class F>
+void visit_targets(Hierarchy h, F&& f)
+{
+    switch (h) {
+        case Hierarchy::deep:           f(DeepTargets {}); break;
+        case Hierarchy::shallow:        f(ShallowTargets {}); break;
+        case Hierarchy::balanced:       f(BalancedTargets {}); break;
+        case Hierarchy::chain:          f(GeneratedTargets<generated::chain> {}); break;
+        case Hierarchy::chain_multiple: f(GeneratedTargets<generated::chain_multiple> {}); break;
+        case Hierarchy::chain_virtual:  f(GeneratedTargets<generated::chain_virtual> {}); break;
+        case Hierarchy::binary:         f(GeneratedTargets<generated::binary> {}); break;
+        case Hierarchy::wide:           f(GeneratedTargets<generated::wide> {}); break;
+        case Hierarchy::comb_100:       f(GeneratedTargets<generated::comb_100> {}); break;
+        case Hierarchy::comb_200:       f(GeneratedTargets<generated::comb_200> {}); break;
+        case Hierarchy::comb_400:       f(GeneratedTargets<generated::comb_400> {}); break;
+    }
+}
+
+// Labels of the targets of hierarchy h: the class names, or Ln for the
+// class at depth n of a generated hierarchy.
+std::vector<std::string> target_labels(Hierarchy h);
+
+extern float dummy;
+
+// Validation of the implementations against dynamic_cast, before they are
+// measured.
+
+// Implementations whose results disagreed with dynamic_cast.
+extern unsigned int num_invalid;
+
+std::string class_name(const A* p);
+std::string describe(const A* from, const void* result);
+
+// The disagreements of cast<I, To> with dynamic_cast<To*> on v, both in
+// null-ness and in the adjusted pointer, or nothing.
+template<Implementation I, class To, class Ptr>
+std::string disagreements(const std::vector<Ptr>& v, const std::string& label)
+{
+    uint64_t num_wrong = 0;
+    size_t first = 0;
+    To* expected_first = nullptr;
+    To* got_first = nullptr;
+    for (size_t i = 0; i < v.size(); i++) {
+        auto expected = dynamic_cast<To*>(ptr(v[i]));
+        auto got = cast<I, To>(ptr(v[i]));
+        if (got != expected && !num_wrong++) {
+            first = i;
+            expected_first = expected;
+            got_first = got;
+        }
+    }
+    if (!num_wrong) return "";
+
+    char buffer[512];
+    snprintf(buffer, sizeof buffer, "%3s: WRONG for %lu of %lu objects, first a %s: %s instead of %s\n",
+            label.c_str(), num_wrong, v.size(), class_name(ptr(v[first])).c_str(),
+            describe(ptr(v[first]), got_first).c_str(), describe(ptr(v[first]), expected_first).c_str());
+    return buffer;
+}
+
+// Checks implementation I against dynamic_cast for all targets. If they
+// disagree, prints where, and counts the implementation as invalid.
+template<Implementation I, class Ptr, class... To>
+bool validate(const std::vector<Ptr>& v, TypeList<To...>, const std::vector<std::string>& labels)
+{
+    if constexpr (I == Implementation::dynamic) return true;
+
+    auto errors = disagreements<I, A>(v, "A");
+    unsigned int i = 0;
+    ((errors += disagreements<I, To>(v, labels[i++])), ...);
+    if (errors.empty()) return true;
+
+    printf("```\n%s```\n", errors.c_str());
+    printf("Not measured: the results disagree with `dynamic_cast`.\n\n");
+    num_invalid++;
+    return false;
+}
+// Casts of the shared_ptr instead of the raw pointer: to a shared_ptr that
+// shares ownership, or to a borrowed_ptr that does not count.
+enum class Ownership { shared, borrowed };
+
+template<Implementation I, Ownership O, class To, class P>
+auto pointer_cast(P&& p)
+{
+    if constexpr (O == Ownership::shared) {
+        if constexpr (I == Implementation::dynamic) return std::dynamic_pointer_cast<To>(std::forward<P>(p));
+        if constexpr (I == Implementation::priori) return priori_pointer_cast<To>(std::forward<P>(p));
+        if constexpr (I == Implementation::kcl) return kcl_pointer_cast<To>(std::forward<P>(p));
+        if constexpr (I == Implementation::interval) return interval_pointer_cast<To>(std::forward<P>(p));
+    } else {
+        if constexpr (I == Implementation::dynamic) return dynamic_borrow_cast<To>(std::forward<P>(p));
+        if constexpr (I == Implementation::priori) return priori_borrow_cast<To>(std::forward<P>(p));
+        if constexpr (I == Implementation::kcl) return kcl_borrow_cast<To>(std::forward<P>(p));
+        if constexpr (I == Implementation::interval) return interval_borrow_cast<To>(std::forward<P>(p));
+    }
+}
+
+const char* pointer_cast_name(Implementation i, Ownership o);
+
+// The same as disagreements() for pointer_cast<I, O, To>. A shared_ptr also
+// has to share ownership with the source, from a copy of it and when moved
+// from one.
+template<Implementation I, Ownership O, class To>
+std::string pointer_disagreements(const std::vector<std::shared_ptr<A>>& v, const std::string& label)
+{
+    auto same_owner = [](const auto& a, const auto& b) { return !a.owner_before(b) && !b.owner_before(a); };
+
+    uint64_t num_wrong = 0;
+    size_t first = 0;
+    for (size_t i = 0; i < v.size(); i++) {
+        auto expected = dynamic_cast<To*>(v[i].get());
+        auto got = pointer_cast<I, O, To>(v[i]);
+        bool ok = got.get() == expected;
+        if constexpr (O == Ownership::shared) {
+            auto source = v[i];
+            auto moved = pointer_cast<I, O, To>(std::move(source));
+            ok = ok && (!got || same_owner(got, v[i]))
+                && moved.get() == expected && (expected ? !source && same_owner(moved, v[i]) : source == v[i]);
+        }
+        if (!ok && !num_wrong++) first = i;
+    }
+    if (!num_wrong) return "";
+
+    char buffer[512];
+    snprintf(buffer, sizeof buffer, "%3s: WRONG for %lu of %lu objects, first a %s\n",
+            label.c_str(), num_wrong, v.size(), class_name(v[first].get()).c_str());
+    return buffer;
+}
+
+template<Implementation I, Ownership O, class... To>
+bool validate_pointer_cast(const std::vector<std::shared_ptr<A>>& v, TypeList<To...>, const std::vector<std::string>& labels)
+{
+    auto errors = pointer_disagreements<I, O, A>(v, "A");
+    unsigned int i = 0;
+    ((errors += pointer_disagreements<I, O, To>(v, labels[i++])), ...);
+    if (errors.empty()) return true;
+
+    printf("```\n%s```\n", errors.c_str());
+    printf("Not measured: the results disagree with `dynamic_cast`.\n\n");
+    num_invalid++;
+    return false;
+}
+
+// Casts every element in [begin, end) to each of the targets in turn.
+template<Implementation I, class... To, class Ptr>
+uint64_t cast_range(TypeList<To...>, const Ptr* begin, const Ptr* end, uint64_t& failures)
+{
+    uint64_t s = 0, f = 0;
+    auto cast_to = [&]<class T>() {
+        for (auto e = begin; e != end; ++e) { auto *p = cast<I, T>(ptr(*e)); p ? s++ : f++; }
+    };
+    (cast_to.template operator()<To>(), ...);
+    failures = f;
+    return s;
+}
+void pin_to_core(unsigned int core);
+
+struct ScalingResult {
+    double aggregate;  // casts per second, all threads
+    double thread_min; // casts per second of the slowest thread
+    double thread_avg;
+    double thread_max;
+};
+
+// Runs pass(t) in each of num_threads threads, pinned to its own core, in
+// num_warmup_passes + num_samples parallel passes. pass(t) returns the number
+// of operations of thread t. Throughput is that of the median pass, from the
+// first thread starting to the last one finishing.
+template<class Pass>
+ScalingResult measure_threads(unsigned int num_threads, Pass pass)
+{
+    const auto num_passes = num_warmup_passes + num_samples;
+
+    std::barrier sync(num_threads);
+    std::vector<std::vector<uint64_t>> start(num_threads), stop(num_threads);
+    std::vector<uint64_t> thread_ops(num_threads);
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t] {
+            pin_to_core(t);
+            for (unsigned int i = 0; i < num_passes; i++) {
+                sync.arrive_and_wait();
+                auto c1 = timing::now_ticks();
+                thread_ops[t] = pass(t);
+                auto c2 = timing::now_ticks();
+                sync.arrive_and_wait();
+                if (i >= num_warmup_passes) {
+                    start[t].push_back(c1);
+                    stop[t].push_back(c2);
+                }
+            }
+        });
+    }
+    for (auto& thread: threads) thread.join();
+
+    std::vector<double> wall_ns;
+    std::vector<std::vector<double>> thread_ns(num_threads);
+    for (unsigned int i = 0; i < num_samples; i++) {
+        uint64_t first = UINT64_MAX, last = 0;
+        for (unsigned int t = 0; t < num_threads; t++) {
+            first = std::min(first, start[t][i]);
+            last = std::max(last, stop[t][i]);
+            thread_ns[t].push_back(double(stop[t][i] - start[t][i]) * timing::ns_per_tick());
+        }
+        wall_ns.push_back(double(last - first) * timing::ns_per_tick());
+    }
+
+    auto median = [](std::vector<double> x) {
+        std::sort(x.begin(), x.end());
+        return x[x.size() / 2];
+    };
+
+    ScalingResult r;
+    uint64_t ops = 0;
+    for (auto o: thread_ops) ops += o;
+    r.aggregate = ops * num_nsecs_per_sec / median(wall_ns);
+    r.thread_min = INFINITY;
+    r.thread_avg = 0;
+    r.thread_max = 0;
+    for (unsigned int t = 0; t < num_threads; t++) {
+        auto thread = thread_ops[t] * num_nsecs_per_sec / median(thread_ns[t]);
+        r.thread_min = std::min(r.thread_min, thread);
+        r.thread_max = std::max(r.thread_max, thread);
+        r.thread_avg += thread / num_threads;
+    }
+    return r;
+}
+
+// Splits `v` into `num_threads` slices, each cast by its own thread to each
+// of the targets.
+template<Implementation I, class Targets, class Ptr>
+ScalingResult measure_scaling(std::vector<Ptr>& v, unsigned int num_threads)
+{
+    const auto num_targets = []<class... To>(TypeList<To...>) { return sizeof...(To); }(Targets {});
+
+    std::vector<uint64_t> failures(num_threads);
+    auto r = measure_threads(num_threads, [&](unsigned int t) {
+        auto begin = v.data() + v.size() * t / num_threads;
+        auto end = v.data() + v.size() * (t + 1) / num_threads;
+        uint64_t f;
+        cast_range<I>(Targets {}, begin, end, f);
+        failures[t] += f;
+        return uint64_t(end - begin) * num_targets;
+    });
+    for (auto f: failures) dummy += f;
+    return r;
+}
+
+// Prints measure(t) for 1 to hardware_concurrency threads.
+template<class Measure>
+void print_scaling(Measure measure)
+{
+    printf("```\n");
+    printf("threads    aggregate   per thread: min       avg       max   efficiency\n");
+    double single = 0;
+    for (unsigned int t = 1; t <= std::max(1u, std::thread::hardware_concurrency()); t++) {
+        ScalingResult r = measure(t);
+        if (t == 1) single = r.aggregate;
+        // Efficiency: aggregate throughput relative to t times the single-threaded one.
+        auto efficiency = r.aggregate / (t * single);
+        printf(
+                "%7u: %7.1f MHz   %7.1f   %7.1f   %7.1f MHz   %5.0f%%     ",
+                t,
+                r.aggregate / num_usecs_per_sec,
+                r.thread_min / num_usecs_per_sec,
+                r.thread_avg / num_usecs_per_sec,
+                r.thread_max / num_usecs_per_sec,
+                efficiency * 100
+              );
+        draw_bar(efficiency / 4);
+    }
+    printf("```\n\n");
+}
+
+// The suites, each in its own translation unit and instantiated for
+// std::shared_ptr<A> and A*. They run on one data set of hierarchy h, but
+// the construction suite, which makes objects of its own.
+template<class Ptr> void run_benchmarks(std::vector<Ptr>& v, Hierarchy h);         // casts_*.cpp
+template<class Ptr> void run_scaling_benchmarks(std::vector<Ptr>& v, Hierarchy h); // scaling.cpp
+template<class Ptr> void run_dispatch(std::vector<Ptr>& v, Hierarchy h);           // dispatch.cpp
+template<class Ptr> void run_registry(std::vector<Ptr>& v, Hierarchy h);           // registry.cpp
+template<class Ptr> void run_construction(Layout layout);                          // construction.cpp
+
+// The shared_ptr casts of the casts suite.
+void run_pointer_casts(std::vector<std::shared_ptr<A>>& v, Hierarchy h);           // pointer_casts.cpp
+
+// Plugin classes registered at a time by the registry suite.
+const unsigned int max_plugins = 64;
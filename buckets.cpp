@@ -0,0 +1,35 @@
+/*
+ * The TypeBuckets inserters of the casts suite, for both pointer types.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#include <vector>
+
+#include "casts.h"
+
+template<class... T>
+void add_inserters(std::vector<Inserter>& table, TypeList<T...>)
+{
+    ((table[id_of<T>] = [](TypeBuckets<A>& buckets, A* p) { buckets.emplace<T>(*interval::adjust<T*>(p)); }), ...);
+}
+
+const std::vector<Inserter>& bucket_inserters()
+{
+    static const auto table = [] {
+        std::vector<Inserter> table(IntervalTree::size);
+        add_inserters(table, DeepClasses {});
+        add_inserters(table, ShallowClasses {});
+        add_inserters(table, BalancedClasses {});
+        add_inserters(table, GeneratedClasses<generated::chain> {});
+        add_inserters(table, GeneratedClasses<generated::chain_multiple> {});
+        add_inserters(table, GeneratedClasses<generated::chain_virtual> {});
+        add_inserters(table, GeneratedClasses<generated::binary> {});
+        add_inserters(table, GeneratedClasses<generated::wide> {});
+        add_inserters(table, GeneratedClasses<generated::comb_100> {});
+        add_inserters(table, GeneratedClasses<generated::comb_200> {});
+        add_inserters(table, GeneratedClasses<generated::comb_400> {});
+        return table;
+    }();
+    return table;
+}
@@ -0,0 +1,263 @@
+/*
+ * Casts suite: every implementation on every data set, once per target,
+ * single-threaded. It is the largest of the suites, so it is instantiated in
+ * one translation unit per pointer type: casts_shared_ptr.cpp and
+ * casts_raw_ptr.cpp.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "benchmark.h"
+#include "batch_cast.h"
+#include "type_buckets.h"
+
+// The same for interval_cast_batch (mask false) or interval_cast_mask
+// (mask true): the output has to hold the results of dynamic_cast that are
+// not null, in order, or one bit for each of them.
+template<class To>
+std::string batch_disagreements(const std::vector<A*>& objects, const std::string& label, bool mask)
+{
+    std::span<A* const> in(objects);
+    std::vector<To*> expected;
+    for (auto p: objects) if (auto q = dynamic_cast<To*>(p)) expected.push_back(q);
+
+    uint64_t num_wrong = 0;
+    size_t first = 0;
+    if (mask) {
+        std::vector<uint64_t> bits((objects.size() + 63) / 64);
+        auto k = interval_cast_mask<To*>(in, bits.data());
+        for (size_t i = 0; i < objects.size(); i++) {
+            bool set = bits[i / 64] >> (i % 64) & 1;
+            if (set != (dynamic_cast<To*>(objects[i]) != nullptr) && !num_wrong++) first = i;
+        }
+        if (k != expected.size()) num_wrong += k > expected.size() ? k - expected.size() : expected.size() - k;
+    } else {
+        std::vector<To*> out(objects.size());
+        auto k = interval_cast_batch<To*>(in, out.data());
+        for (size_t i = 0; i < std::max(k, expected.size()); i++) {
+            if ((i >= k || i >= expected.size() || out[i] != expected[i]) && !num_wrong++) first = i;
+        }
+    }
+    if (!num_wrong) return "";
+
+    char buffer[256];
+    snprintf(buffer, sizeof buffer, "%3s: WRONG for %lu of %lu objects, first at %s %zu\n",
+            label.c_str(), num_wrong, objects.size(), mask ? "object" : "output", first);
+    return buffer;
+}
+
+template<class... To>
+bool validate_batched(const std::vector<A*>& objects, TypeList<To...>, const std::vector<std::string>& labels, bool mask)
+{
+    auto errors = batch_disagreements<A>(objects, "A", mask);
+    unsigned int i = 0;
+    ((errors += batch_disagreements<To>(objects, labels[i++], mask)), ...);
+    if (errors.empty()) return true;
+
+    printf("```\n%s```\n", errors.c_str());
+    printf("Not measured: the results disagree with `dynamic_cast`.\n\n");
+    num_invalid++;
+    return false;
+}
+
+// One implementation on one data set, once per target, and for the inline
+// caches their hit rates.
+template<Implementation I, class Ptr, class... To>
+void run_implementation(std::vector<Ptr>& v, TypeList<To...>, const std::vector<std::string>& labels)
+{
+    if (!selected(I)) return;
+
+    constexpr bool cached = I == Implementation::inline_cache_1 || I == Implementation::inline_cache_4;
+    constexpr unsigned int ways = I == Implementation::inline_cache_1 ? 1 : 4;
+
+    printf("Implementation: `%s`\n", implementation_name(I));
+    current.implementation = implementation_name(I);
+    if constexpr (!available<I>(TypeList<To...> {})) {
+        printf("Not available for this hierarchy.\n\n");
+    } else {
+        if (!validate<I>(v, TypeList<To...> {}, labels)) return;
+
+        double hit_rates[sizeof...(To)];
+        float sum = 0;
+        unsigned int i = 0;
+
+        printf("```\n");
+        dummy += run("A", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = cast<I, A>(ptr(e)); p ? s++ : dummy++; } return s; });
+        ([&] {
+            if constexpr (cached) inline_cache<ways, To>().reset_statistics();
+            sum += run(labels[i], [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = cast<I, To>(ptr(e)); p ? s++ : dummy++; } return s; });
+            if constexpr (cached) hit_rates[i] = inline_cache<ways, To>().hit_rate();
+            i++;
+        }(), ...);
+        print_average(sum, sizeof...(To));
+        if constexpr (cached) {
+            printf("HIT:");
+            for (i = 0; i < sizeof...(To); i++) printf(" %s %5.1f%%", labels[i].c_str(), hit_rates[i] * 100);
+            printf("\n");
+        }
+        printf("```\n\n");
+    }
+}
+
+// interval_cast_batch and interval_cast_mask over the whole data set, once
+// per target.
+template<class... To>
+void run_batched(std::vector<A*>& objects, TypeList<To...>, const std::vector<std::string>& labels)
+{
+    std::span<A* const> in(objects);
+    float sum;
+    unsigned int i, measured;
+
+    printf("Implementation: `interval_cast_batch` (compacted output)\n");
+    current.implementation = "interval_cast_batch";
+    if (validate_batched(objects, TypeList<To...> {}, labels, false)) {
+        printf("```\n");
+        std::vector<A*> all(objects.size());
+        dummy += run("A", [&]() -> uint64_t { return interval_cast_batch<A*>(in, all.data()); });
+        sum = 0;
+        i = measured = 0;
+        ([&] {
+            if (interval::range_of<To, A::interval_tree>.empty()) {
+                printf("%3s: not part of the hierarchy, rejected at compile time\n", labels[i++].c_str());
+                return;
+            }
+            std::vector<To*> out(objects.size());
+            sum += run(labels[i++], [&]() -> uint64_t { return interval_cast_batch<To*>(in, out.data()); });
+            measured++;
+        }(), ...);
+        print_average(sum, measured); // Z is not measured
+        printf("```\n\n");
+    }
+
+    printf("Implementation: `interval_cast_mask` (bitmask)\n");
+    current.implementation = "interval_cast_mask";
+    if (validate_batched(objects, TypeList<To...> {}, labels, true)) {
+        printf("```\n");
+        std::vector<uint64_t> mask((objects.size() + 63) / 64);
+        dummy += run("A", [&]() -> uint64_t { return interval_cast_mask<A*>(in, mask.data()); });
+        sum = 0;
+        i = measured = 0;
+        ([&] {
+            if (interval::range_of<To, A::interval_tree>.empty()) {
+                printf("%3s: not part of the hierarchy, rejected at compile time\n", labels[i++].c_str());
+                return;
+            }
+            sum += run(labels[i++], [&]() -> uint64_t { return interval_cast_mask<To*>(in, mask.data()); });
+            measured++;
+        }(), ...);
+        print_average(sum, measured); // Z is not measured
+        printf("```\n\n");
+    }
+}
+
+// Copies the object at p into the segment of its class.
+using Inserter = void (*)(TypeBuckets<A>&, A*);
+
+// The inserters of all classes, indexed by type ID. In buckets.cpp, as it
+// instantiates TypeBuckets::emplace() for every class.
+const std::vector<Inserter>& bucket_inserters();
+
+// Copies of the objects of v, grouped by class.
+template<class Ptr>
+TypeBuckets<A> to_buckets(const std::vector<Ptr>& v)
+{
+    auto& table = bucket_inserters();
+    TypeBuckets<A> buckets;
+    for (auto& e: v) table[ptr(e)->interval_type_id()](buckets, ptr(e));
+    return buckets;
+}
+
+// for_each<To> has to visit as many objects as dynamic_cast<To*> succeeds
+// for, and only objects that are To.
+template<class To, class Ptr>
+std::string bucket_disagreements(const std::vector<Ptr>& v, TypeBuckets<A>& buckets, const std::string& label)
+{
+    uint64_t expected = 0, visited = 0, wrong = 0;
+    for (auto& e: v) expected += dynamic_cast<To*>(ptr(e)) != nullptr;
+    buckets.for_each<To>([&](To& o) {
+        visited++;
+        if (dynamic_cast<To*>(dynamic_cast<A*>(&o)) != &o) wrong++;
+    });
+    if (visited == expected && !wrong) return "";
+
+    char buffer[256];
+    snprintf(buffer, sizeof buffer, "%3s: WRONG, %lu objects visited instead of %lu, %lu of them not %s\n",
+            label.c_str(), visited, expected, wrong, label.c_str());
+    return buffer;
+}
+
+// TypeBuckets::for_each over a copy of the data set, once per target. The
+// copy is grouped by class, so the order of the run does not apply.
+template<class Ptr, class... To>
+void run_bucketed(std::vector<Ptr>& v, TypeList<To...>, const std::vector<std::string>& labels)
+{
+    auto buckets = to_buckets(v);
+
+    printf("Implementation: `TypeBuckets::for_each` (%zu segments)\n", buckets.num_segments());
+    current.implementation = "TypeBuckets::for_each";
+
+    auto errors = bucket_disagreements<A>(v, buckets, "A");
+    unsigned int i = 0;
+    ((errors += bucket_disagreements<To>(v, buckets, labels[i++])), ...);
+    if (!errors.empty()) {
+        printf("```\n%s```\n", errors.c_str());
+        printf("Not measured: the results disagree with `dynamic_cast`.\n\n");
+        num_invalid++;
+        return;
+    }
+
+    auto visit = [&]<class T>() -> uint64_t {
+        uint64_t s = 0;
+        buckets.template for_each<T>([&](T& o) { s += o.get(); });
+        return s;
+    };
+    printf("```\n");
+    dummy += run("A", [&] { return visit.template operator()<A>(); });
+    float sum = 0;
+    i = 0;
+    ((sum += run(labels[i++], [&] { return visit.template operator()<To>(); })), ...);
+    print_average(sum, sizeof...(To));
+    printf("```\n\n");
+}
+
+template<class Ptr>
+void run_benchmarks(std::vector<Ptr>& v, Hierarchy h)
+{
+    // Cache warming
+    dummy += [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = static_cast <      A*>(ptr(e)); p ? s++ : dummy++; } return s; }();
+
+    printf("Base-line: static_cast\n");
+    current.implementation = "static_cast";
+    printf("```\n");
+    dummy += run("-", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = static_cast <      A*>(ptr(e)); p ? s++ : dummy++; } return s; });
+    printf("```\n\n");
+
+    auto labels = target_labels(h);
+    visit_targets(h, [&](auto targets) {
+        run_implementation<Implementation::dynamic>(v, targets, labels);
+        run_implementation<Implementation::priori>(v, targets, labels);
+        run_implementation<Implementation::kcl>(v, targets, labels);
+        run_implementation<Implementation::interval>(v, targets, labels);
+        run_implementation<Implementation::inline_cache_1>(v, targets, labels);
+        run_implementation<Implementation::inline_cache_4>(v, targets, labels);
+        if (batched) {
+            // The batched casts take a span of raw pointers.
+            std::vector<A*> objects;
+            objects.reserve(v.size());
+            for (auto& e: v) objects.push_back(ptr(e));
+            run_batched(objects, targets, labels);
+        }
+        if (bucketed) run_bucketed(v, targets, labels);
+    });
+    if constexpr (std::is_same_v<Ptr, std::shared_ptr<A>>)
+        if (pointer_casts) run_pointer_casts(v, h);
+}
@@ -0,0 +1,9 @@
+/*
+ * The casts suite for A*, in the arena and pools layouts.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#include "casts.h"
+
+template void run_benchmarks<A*>(std::vector<A*>&, Hierarchy);
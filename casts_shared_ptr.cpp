@@ -0,0 +1,9 @@
+/*
+ * The casts suite for std::shared_ptr<A>, in the shared_ptr layouts.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#include "casts.h"
+
+template void run_benchmarks<std::shared_ptr<A>>(std::vector<std::shared_ptr<A>>&, Hierarchy);
@@ -0,0 +1,135 @@
+#!/bin/sh
+#
+# Builds dynamic_cast_benchmark in every build variant of the Makefile (or
+# the given ones), runs it on each with the same arguments, and puts the
+# results side by side:
+#
+#     build/variants.csv   the time per cast of every measurement, one column
+#                          per variant
+#     standard output      per cast implementation, the geometric mean of its
+#                          times on each variant, and the fastest of them on
+#                          each variant (but the static_cast baseline)
+#
+# Variants that cannot be built, e.g. for a missing compiler or libc++, are
+# left out. The output of each run is in build/<variant>/output.md. A variant
+# on which an implementation disagreed with dynamic_cast is still compared,
+# without that implementation, and listed with a warning.
+#
+# Usage: ./compare_variants.sh [VARIANT]... [-- BENCHMARK ARGUMENTS]
+# e.g.   ./compare_variants.sh gcc-libstdcxx clang-libcxx -- --layout arena
+#
+# Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+
+variants=""
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do
+    variants="$variants $1"
+    shift
+done
+[ "$1" = "--" ] && shift
+[ -z "$variants" ] && variants=$(make -s print-variants)
+
+mkdir -p build
+csvs=""
+invalid=""
+for v in $variants; do
+    if ! make -j"$(nproc)" "build/$v/dynamic_cast_benchmark" > "build/$v.log" 2>&1; then
+        echo "$v: could not be built, see build/$v.log" >&2
+        continue
+    fi
+    rm -f "build/$v.log"
+    echo "$v: running" >&2
+    "build/$v/dynamic_cast_benchmark" --csv "build/$v/results.csv" "$@" > "build/$v/output.md"
+    status=$?
+    # 3: some implementation disagreed with dynamic_cast and was left out.
+    if [ $status -ne 0 ] && [ $status -ne 3 ]; then
+        echo "$v: failed with status $status, see build/$v/output.md" >&2
+        continue
+    fi
+    if [ $status -eq 3 ]; then
+        echo "$v: warning: an implementation disagreed with dynamic_cast and is missing, see build/$v/output.md" >&2
+        invalid="$invalid $v"
+    fi
+    csvs="$csvs build/$v/results.csv"
+done
+
+if [ -z "$csvs" ]; then
+    echo "No variant could be run." >&2
+    exit 1
+fi
+
+# Joins the CSV files of write_csv() on the identifying columns 1-6, with the
+# median time per cast (column 10) of each. The means and the ranking only
+# take the single casts of the cast runs: the batched, bucketed, dispatch,
+# construction and startup records measure other work per object.
+awk -F, -v out=build/variants.csv \
+    -v casts="static_cast dynamic_cast priori_cast kcl_dynamic_cast interval_cast INLINE_CACHED_CAST(1) INLINE_CACHED_CAST(4)" '
+    BEGIN {
+        split(casts, names_of_casts, " ")
+        for (c in names_of_casts) is_cast[names_of_casts[c]] = 1
+    }
+    FNR == 1 {
+        split(FILENAME, path, "/")
+        variant[++num_variants] = path[2]
+        next
+    }
+    {
+        key = $1 "," $2 "," $3 "," $4 "," $5 "," $6
+        if (!(key in seen)) {
+            seen[key] = 1
+            keys[++num_keys] = key
+            implementation[key] = $5
+        }
+        ns[key, num_variants] = $10
+    }
+    END {
+        header = "layout,run,hierarchy,data_set,implementation,target"
+        for (v = 1; v <= num_variants; v++) header = header "," variant[v]
+        print header > out
+        for (k = 1; k <= num_keys; k++) {
+            line = keys[k]
+            for (v = 1; v <= num_variants; v++) line = line "," ns[keys[k], v]
+            print line > out
+        }
+
+        # Geometric means over the measurements that every variant has, so
+        # that the columns compare the same casts.
+        for (k = 1; k <= num_keys; k++) {
+            key = keys[k]
+            split(key, columns, ",")
+            if (!(columns[5] in is_cast) || columns[2] == "startup" || columns[2] == "construction") continue
+            complete = 1
+            for (v = 1; v <= num_variants; v++) if (ns[key, v] == "" || ns[key, v] <= 0) complete = 0
+            if (!complete) continue
+            i = implementation[key]
+            if (!(i in count)) names[++num_names] = i
+            count[i]++
+            for (v = 1; v <= num_variants; v++) log_sum[i, v] += log(ns[key, v])
+        }
+
+        printf "Geometric mean of the time per cast in ns, over the single casts that all variants measured.\n\n"
+        printf "%-28s", "implementation"
+        for (v = 1; v <= num_variants; v++) printf " %24s", variant[v]
+        printf "\n"
+        for (n = 1; n <= num_names; n++) {
+            i = names[n]
+            printf "%-28s", i
+            for (v = 1; v <= num_variants; v++) {
+                mean[i, v] = exp(log_sum[i, v] / count[i])
+                printf " %24.3f", mean[i, v]
+            }
+            printf "\n"
+        }
+        printf "%-28s", "fastest"
+        for (v = 1; v <= num_variants; v++) {
+            best = ""
+            for (n = 1; n <= num_names; n++)
+                if (names[n] != "static_cast" && (best == "" || mean[names[n], v] < mean[best, v])) best = names[n]
+            printf " %24s", best
+        }
+        printf "\n\nAll measurements: %s\n", out
+    }
+' $csvs
+
+for v in $invalid; do
+    echo "Warning: on $v, an implementation disagreed with dynamic_cast and is not compared, see build/$v/output.md"
+done
@@ -0,0 +1,78 @@
+/*
+ * Construction suite: makes objects of one class in the way of the layout,
+ * then destroys them. Every constructor below A calls priori(this) and
+ * interval_id(this); KCL only adds a vtable entry.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "benchmark.h"
+
+// Makes `count` objects of class T in a fresh set of arenas, and destroys
+// them again with the vector and the arenas.
+template<class T, class Ptr>
+uint64_t construct_and_destroy(Layout layout, uint64_t count)
+{
+    DataSets<Ptr> data(layout);
+    std::vector<Ptr> v;
+    v.reserve(count);
+    for (uint64_t i = 0; i < count; i++) v.emplace_back(data.template make<T>());
+    return v.size();
+}
+
+// A and the targets of a hierarchy but Z, single-threaded and then with 1 to
+// hardware_concurrency threads.
+template<class Ptr, class... To>
+void run_construction_classes(Layout layout, TypeList<To...>, const std::vector<std::string>& labels)
+{
+    size_t k = 0;
+    auto single = [&]<class T>(const std::string& label) {
+        if constexpr (!std::is_same_v<T, Z>) run(label, [&] { return construct_and_destroy<T, Ptr>(layout, n); });
+    };
+    single.template operator()<A>("A");
+    (single.template operator()<To>(labels[k++]), ...);
+    printf("```\n\n");
+
+    k = 0;
+    auto threads = [&]<class T>(const std::string& label) {
+        if constexpr (!std::is_same_v<T, Z>) {
+            printf("Class %s, threads:\n", label.c_str());
+            print_scaling([&](unsigned int num_threads) {
+                return measure_threads(num_threads, [&](unsigned int t) {
+                    return construct_and_destroy<T, Ptr>(layout, n * (t + 1) / num_threads - n * t / num_threads);
+                });
+            });
+        }
+    };
+    threads.template operator()<A>("A");
+    (threads.template operator()<To>(labels[k++]), ...);
+}
+
+template<class Ptr>
+void run_construction(Layout layout)
+{
+    printf("\n\n\n\n\n");
+    printf("## Construction and destruction\n\n");
+    current.run = "construction";
+    current.data_set = "";
+    current.implementation = "construction";
+    for (auto h: hierarchies) {
+        max_num_ops = 0;
+        printf("\n\n\n\n\n");
+        printf("### Class hierarchy: %s\n\n", hierarchy_name(h));
+        current.hierarchy = hierarchy_name(h);
+        printf("Objects of each class made like the objects of the data sets, then destroyed. Per object:\n");
+        printf("```\n");
+        auto labels = target_labels(h);
+        visit_targets(h, [&](auto targets) { run_construction_classes<Ptr>(layout, targets, labels); });
+    }
+}
+
+template void run_construction<std::shared_ptr<A>>(Layout);
+template void run_construction<A*>(Layout);
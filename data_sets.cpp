@@ -0,0 +1,113 @@
+/*
+ * Generation of the data sets: objects of randomly drawn classes of one
+ * hierarchy, made in the way of the layout.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "benchmark.h"
+
+// Draws one of the classes from, ..., from + width. With the Zipf
+// distribution, class from + k is drawn with a probability proportional to
+// 1 / (k + 1)^s.
+class ClassDistribution {
+public:
+    ClassDistribution(unsigned int from, unsigned int width) : from(from), width(width) {
+        if (distribution != Distribution::zipf) return;
+        double sum = 0;
+        for (unsigned int k = 0; k <= width; k++) cdf.push_back(sum += 1 / std::pow(k + 1, zipf_exponent));
+        for (auto& p: cdf) p /= sum;
+    }
+
+    unsigned int operator()() const {
+        if (cdf.empty()) return from + rand() % (width + 1);
+        auto u = rand() / (RAND_MAX + 1.0);
+        return from + std::min<size_t>(std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin(), width);
+    }
+
+private:
+    unsigned int from, width;
+    std::vector<double> cdf;
+};
+
+template<class Ptr>
+void generate_data(DataSets<Ptr>& data, std::vector<Ptr>& v, Hierarchy h, unsigned int from, unsigned int width)
+{
+    ClassDistribution draw(from, width);
+    v.resize(n); // ensure contiguous memory
+    auto make = [&](uint64_t i, uint64_t val) {
+        if (h == Hierarchy::deep) {
+            switch(val) {
+                case  0: v[i] = data.template make<A>(); break;
+                case  1: v[i] = data.template make<deep::B>(); break;
+                case  2: v[i] = data.template make<deep::C>(); break;
+                case  3: v[i] = data.template make<deep::D>(); break;
+                case  4: v[i] = data.template make<deep::E>(); break;
+                case  5: v[i] = data.template make<deep::F>(); break;
+                case  6: v[i] = data.template make<deep::G>(); break;
+                case  7: v[i] = data.template make<deep::H>(); break;
+            }
+        } else if (h == Hierarchy::shallow) {
+            switch(val) {
+                case  0: v[i] = data.template make<A>(); break;
+                case  1: v[i] = data.template make<shallow::B>(); break;
+                case  2: v[i] = data.template make<shallow::C>(); break;
+                case  3: v[i] = data.template make<shallow::D>(); break;
+                case  4: v[i] = data.template make<shallow::E>(); break;
+                case  5: v[i] = data.template make<shallow::F>(); break;
+                case  6: v[i] = data.template make<shallow::G>(); break;
+                case  7: v[i] = data.template make<shallow::H>(); break;
+            }
+        } else if (h == Hierarchy::balanced) {
+            switch(val) {
+                case  0: v[i] = data.template make<A>(); break;
+                case  1: v[i] = data.template make<balanced::B>(); break;
+                case  2: v[i] = data.template make<balanced::C>(); break;
+                case  3: v[i] = data.template make<balanced::D>(); break;
+                case  4: v[i] = data.template make<balanced::E>(); break;
+                case  5: v[i] = data.template make<balanced::F>(); break;
+                case  6: v[i] = data.template make<balanced::G>(); break;
+                case  7: v[i] = data.template make<balanced::H>(); break;
+            }
+        } else if (h == Hierarchy::chain) {
+            v[i] = make_generated<generated::chain>(data, val);
+        } else if (h == Hierarchy::chain_multiple) {
+            v[i] = make_generated<generated::chain_multiple>(data, val);
+        } else if (h == Hierarchy::chain_virtual) {
+            v[i] = make_generated<generated::chain_virtual>(data, val);
+        } else if (h == Hierarchy::binary) {
+            v[i] = make_generated<generated::binary>(data, val);
+        } else if (h == Hierarchy::wide) {
+            v[i] = make_generated<generated::wide>(data, val);
+        } else if (h == Hierarchy::comb_100) {
+            v[i] = make_generated<generated::comb_100>(data, val);
+        } else if (h == Hierarchy::comb_200) {
+            v[i] = make_generated<generated::comb_200>(data, val);
+        } else if (h == Hierarchy::comb_400) {
+            v[i] = make_generated<generated::comb_400>(data, val);
+        }
+    };
+
+    // The objects are allocated in the order of v, or in random order for the
+    // scattered placement. Either way, the classes are drawn in the order of v.
+    if (placement == Placement::scattered) {
+        std::vector<uint32_t> classes(n);
+        for (auto& c: classes) c = draw();
+        std::vector<uint64_t> allocation(n);
+        for (uint64_t i = 0; i < n; i++) allocation[i] = i;
+        std::shuffle(allocation.begin(), allocation.end(), std::default_random_engine { 2 });
+        for (auto i: allocation) make(i, classes[i]);
+    } else {
+        for (uint64_t i = 0; i < n; i++) make(i, draw());
+    }
+}
+
+template void generate_data<std::shared_ptr<A>>(DataSets<std::shared_ptr<A>>&, std::vector<std::shared_ptr<A>>&, Hierarchy, unsigned int, unsigned int);
+template void generate_data<A*>(DataSets<A*>&, std::vector<A*>&, Hierarchy, unsigned int, unsigned int);
@@ -0,0 +1,145 @@
+/*
+ * Dispatch suite: finds out which class of a hierarchy an object is, and
+ * runs the handler for that class. The handler of class T adds id_of<T>, so
+ * for every object, every dispatcher has to arrive at its type ID.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "benchmark.h"
+
+// if (cast<T1>(p)) ... else if (cast<T2>(p)) ... 
+template<Implementation I, class... T>
+uint32_t dispatch_chain(A* p, TypeList<T...>)
+{
+    uint32_t id = 0;
+    ((cast<I, T>(p) ? (id = id_of<T>, true) : false) || ...);
+    return id;
+}
+
+struct SumVisitor : Visitor {
+    uint64_t sum { 0 };
+#define VISIT(T) void visit(T&) override { sum += id_of<T>; }
+    HAND_WRITTEN_CLASSES(VISIT)
+#undef VISIT
+};
+
+// The same objects by value, in std::variant.
+template<class Ptr, class... T>
+std::vector<std::variant<T...>> to_variants(const std::vector<Ptr>& v, TypeList<T...>)
+{
+    std::vector<std::variant<T...>> variants;
+    variants.reserve(v.size());
+    for (auto& e: v) {
+        auto id = ptr(e)->interval_type_id();
+        ((id == id_of<T> ? (variants.emplace_back(std::in_place_type<T>), true) : false) || ...);
+    }
+    return variants;
+}
+
+using Handler = void (*)(A*, uint64_t&);
+
+template<class T>
+void handle(A*, uint64_t& sum) { sum += id_of<T>; }
+
+// Handlers indexed by interval type ID, which is dense.
+template<class... T>
+std::vector<Handler> handler_table(TypeList<T...>)
+{
+    std::vector<Handler> table(IntervalTree::size, &handle<A>);
+    ((table[id_of<T>] = &handle<T>), ...);
+    return table;
+}
+
+template<class Ptr, class Classes>
+void run_dispatch_suite(std::vector<Ptr>& v, Classes classes)
+{
+    auto variants = to_variants(v, classes);
+    auto table = handler_table(classes);
+
+    // Each dispatcher adds up the handlers of objects first, ..., last - 1:
+    // the type ID of a single object, or the sum over all of them.
+    struct Dispatcher {
+        const char* label;
+        std::function<uint64_t(size_t, size_t)> sum;
+        bool selected;
+    };
+    auto chain = [&]<Implementation I>() -> std::function<uint64_t(size_t, size_t)> {
+        return [&v, classes](size_t first, size_t last) -> uint64_t {
+            uint64_t s = 0;
+            for (size_t k = first; k < last; k++) s += dispatch_chain<I>(ptr(v[k]), classes);
+            return s;
+        };
+    };
+    Dispatcher dispatchers[] = {
+        { "dyn", chain.template operator()<Implementation::dynamic>(), selected(Implementation::dynamic) },
+        { "pri", chain.template operator()<Implementation::priori>(), selected(Implementation::priori) },
+        { "kcl", chain.template operator()<Implementation::kcl>(), selected(Implementation::kcl) },
+        { "int", chain.template operator()<Implementation::interval>(), selected(Implementation::interval) },
+        { "vis", [&v](size_t first, size_t last) -> uint64_t {
+            SumVisitor visitor;
+            for (size_t k = first; k < last; k++) ptr(v[k])->accept(visitor);
+            return visitor.sum;
+        }, true },
+        { "var", [&variants](size_t first, size_t last) -> uint64_t {
+            uint64_t s = 0;
+            for (size_t k = first; k < last; k++)
+                std::visit([&s](auto& object) { s += id_of<std::remove_cvref_t<decltype(object)>>; }, variants[k]);
+            return s;
+        }, true },
+        { "tab", [&v, &table](size_t first, size_t last) -> uint64_t {
+            uint64_t s = 0;
+            for (size_t k = first; k < last; k++) table[ptr(v[k])->interval_type_id()](ptr(v[k]), s);
+            return s;
+        }, true },
+    };
+
+    // Lower bound: just the type ID, without dispatch.
+    auto expected = [&v]() -> uint64_t { uint64_t s = 0; for (auto& e: v) s += ptr(e)->interval_type_id(); return s; };
+
+    printf("Dispatch: if-chains of dynamic_cast (dyn), priori_cast (pri), kcl_dynamic_cast (kcl), interval_cast (int); "
+           "virtual accept() (vis); std::visit (var); handler table indexed by type ID (tab). Per object:\n");
+    current.implementation = "dispatch";
+    printf("```\n");
+    dummy += run("id", [&]() -> uint64_t { dummy += expected(); return v.size(); });
+    for (auto& d: dispatchers) {
+        if (!d.selected) continue;
+
+        // Every object has to reach the handler of its own class.
+        uint64_t wrong = 0, first_wrong = 0;
+        for (size_t k = 0; k < v.size(); k++) {
+            if (d.sum(k, k + 1) == ptr(v[k])->interval_type_id()) continue;
+            if (wrong++ == 0) first_wrong = k;
+        }
+        if (wrong > 0) {
+            printf("%3s: WRONG for %lu objects, the first is object %lu (type ID %u, handler of %lu), not measured\n",
+                    d.label, wrong, first_wrong, ptr(v[first_wrong])->interval_type_id(), d.sum(first_wrong, first_wrong + 1));
+            num_invalid++;
+            continue;
+        }
+        run(d.label, [&]() -> uint64_t { dummy += d.sum(0, v.size()); return v.size(); });
+    }
+    printf("```\n\n");
+}
+
+template<class Ptr>
+void run_dispatch(std::vector<Ptr>& v, Hierarchy h)
+{
+    switch (h) {
+        case Hierarchy::deep:     run_dispatch_suite(v, DeepClasses {}); break;
+        case Hierarchy::shallow:  run_dispatch_suite(v, ShallowClasses {}); break;
+        case Hierarchy::balanced: run_dispatch_suite(v, BalancedClasses {}); break;
+        default: printf("The dispatch suite covers the hand-written hierarchies only.\n\n");
+    }
+}
+
+template void run_dispatch<std::shared_ptr<A>>(std::vector<std::shared_ptr<A>>&, Hierarchy);
+template void run_dispatch<A*>(std::vector<A*>&, Hierarchy);
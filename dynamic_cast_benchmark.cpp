@@ -28,95 +28,83 @@
 */
 
 #include <iostream>
-#include <chrono>
 #include <vector>
 #include <memory>
 #include <cstdlib>
+#include <cctype>
 #include <typeinfo>
 #include <string>
-#include <functional>
 #include <random>
 #include <algorithm>
+#include <thread>
+#include <map>
+#include <sstream>
+#include <fstream>
+#include <limits>
 
-#include "priori/priori.h"
-#include "KCL/KCL_RTTI.h"
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
-enum class Hierarchy { deep, shallow, balanced };
-enum class SortOrder { aligned, shuffled };
+#include "benchmark.h"
 
-auto max_num_ops = 0;
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
 
-const uint64_t n = 2'000'000; // number of iterations
-const auto num_usecs_per_sec = 1'000'000;
+int max_num_ops = 0;
 
-struct A : priori::Base {
-    KCL_RTTI_IMPL();
-    uint64_t get() { return x; };
-    uint64_t x { 1 };
+// The workload, see usage(), and its defaults.
+const uint64_t default_n = 2'000'000;
+const unsigned int default_num_warmup_passes = 2;
+const unsigned int default_num_samples = 10;
+uint64_t n = default_n; // number of iterations
+unsigned int num_warmup_passes = default_num_warmup_passes; // untimed passes before each measurement
+unsigned int num_samples = default_num_samples;             // timed passes per measurement
+
+// Of the classes in the mixed data sets.
+Distribution distribution = Distribution::uniform;
+double zipf_exponent = 1.0;
+
+// Order of the objects in runs 1, 2, ...
+struct Order {
+    SortOrder order;
+    unsigned int stride;
 };
-KCL_RTTI_REGISTER(A);
-
-namespace deep {
-    struct B : A { KCL_RTTI_IMPL(); B() { priori(this); } };
-    struct C : B { KCL_RTTI_IMPL(); C() { priori(this); } };
-    struct D : C { KCL_RTTI_IMPL(); D() { priori(this); } };
-    struct E : D { KCL_RTTI_IMPL(); E() { priori(this); } };
-    struct F : E { KCL_RTTI_IMPL(); F() { priori(this); } };
-    struct G : F { KCL_RTTI_IMPL(); G() { priori(this); } };
-    struct H : G { KCL_RTTI_IMPL(); H() { priori(this); } };
-}
-KCL_RTTI_REGISTER(deep::B, A);
-KCL_RTTI_REGISTER(deep::C, deep::B);
-KCL_RTTI_REGISTER(deep::D, deep::C);
-KCL_RTTI_REGISTER(deep::E, deep::D);
-KCL_RTTI_REGISTER(deep::F, deep::E);
-KCL_RTTI_REGISTER(deep::G, deep::F);
-KCL_RTTI_REGISTER(deep::H, deep::G);
-
-namespace shallow {
-    struct B : A { KCL_RTTI_IMPL(); B() { priori(this); } };
-    struct C : A { KCL_RTTI_IMPL(); C() { priori(this); } };
-    struct D : A { KCL_RTTI_IMPL(); D() { priori(this); } };
-    struct E : A { KCL_RTTI_IMPL(); E() { priori(this); } };
-    struct F : A { KCL_RTTI_IMPL(); F() { priori(this); } };
-    struct G : A { KCL_RTTI_IMPL(); G() { priori(this); } };
-    struct H : A { KCL_RTTI_IMPL(); H() { priori(this); } };
-}
-KCL_RTTI_REGISTER(shallow::B, A);
-KCL_RTTI_REGISTER(shallow::C, shallow::B);
-KCL_RTTI_REGISTER(shallow::D, shallow::C);
-KCL_RTTI_REGISTER(shallow::E, shallow::D);
-KCL_RTTI_REGISTER(shallow::F, shallow::E);
-KCL_RTTI_REGISTER(shallow::G, shallow::F);
-KCL_RTTI_REGISTER(shallow::H, shallow::G);
-
-namespace balanced {
-    struct B : A { KCL_RTTI_IMPL(); B() { priori(this); } };
-    struct C : B { KCL_RTTI_IMPL(); C() { priori(this); } };
-    struct D : B { KCL_RTTI_IMPL(); D() { priori(this); } };
-
-    struct E : A { KCL_RTTI_IMPL(); E() { priori(this); } };
-    struct F : E { KCL_RTTI_IMPL(); F() { priori(this); } };
-    struct G : E { KCL_RTTI_IMPL(); G() { priori(this); } };
-    struct H : E { KCL_RTTI_IMPL(); H() { priori(this); } };
-}
-KCL_RTTI_REGISTER(balanced::B, A);
-KCL_RTTI_REGISTER(balanced::C, balanced::B);
-KCL_RTTI_REGISTER(balanced::D, balanced::B);
-KCL_RTTI_REGISTER(balanced::E, A);
-KCL_RTTI_REGISTER(balanced::F, balanced::E);
-KCL_RTTI_REGISTER(balanced::G, balanced::E);
-KCL_RTTI_REGISTER(balanced::H, balanced::E);
-
-// Same interface as A, but not related.
-struct Z {
-    KCL_RTTI_IMPL();
-    uint64_t get() { return 1; };
+std::vector<Order> orders = { { SortOrder::aligned, 0 }, { SortOrder::shuffled, 0 } };
+
+// Where the objects are placed in memory, one pass over the layouts per
+// placement, and the one of the current pass.
+std::vector<Placement> placements = { Placement::heap };
+Placement placement = Placement::heap;
+
+// Objects per data set of the page placement at most. All data sets are made
+// at once, at 4 KiB per object: 15 of 32K objects take about 2 GiB.
+const uint64_t max_page_elements = 32 << 10;
+
+const Hierarchy all_hierarchies[] = {
+    Hierarchy::deep, Hierarchy::shallow, Hierarchy::balanced,
+    Hierarchy::chain, Hierarchy::chain_multiple, Hierarchy::chain_virtual, Hierarchy::binary, Hierarchy::wide,
+    Hierarchy::comb_100, Hierarchy::comb_200, Hierarchy::comb_400,
+};
+const Implementation all_implementations[] = {
+    Implementation::dynamic, Implementation::priori, Implementation::kcl, Implementation::interval,
+    Implementation::inline_cache_1, Implementation::inline_cache_4,
 };
-KCL_RTTI_REGISTER(Z);
 
+// What to run.
+std::vector<Hierarchy> hierarchies(std::begin(all_hierarchies), std::end(all_hierarchies));
+std::vector<std::string> data_set_names = { "successful", "fails", "mixed" };
+std::vector<Implementation> implementations(std::begin(all_implementations), std::end(all_implementations));
+bool batched = true; // interval_cast_batch and interval_cast_mask
+bool bucketed = true; // TypeBuckets::for_each
+bool pointer_casts = true; // shared_ptr and borrowed casts, in the shared_ptr layouts
 
-void draw_bar(float percent, std::string s = "-") {
+void draw_bar(float percent, std::string s) {
     const auto cols = 60;
     uint64_t width = cols * percent * 4.0;
     if (width > cols) {
@@ -131,231 +119,463 @@ void draw_bar(float percent, std::string s = "-") {
     }
 }
 
+// Width of the statistics columns printed by run(), so that the AVG line
+// can align its bar with the others.
+int stats_columns = 0;
+
+// Hardware counters of the main thread, reported per cast.
+perf::Counters counters;
+
+// What run() is measuring, all but the target. Nothing is recorded while
+// current.run is empty.
+results::Record current;
+std::vector<results::Record> records;
+
 uint64_t run(std::string label, std::function<uint64_t()> benchmark)
 {
-    auto t1 = std::chrono::high_resolution_clock::now();
-    auto successes = benchmark();
-    auto t2 = std::chrono::high_resolution_clock::now();
+    counters.reset();
+    auto m = timing::measure(benchmark, num_warmup_passes, num_samples, counters);
+    auto c = counters.read();
 
-    auto usecs_per_iterations =
-        std::chrono::duration_cast<std::chrono::microseconds>(t2-t1).count();
-    auto num_ops = num_usecs_per_sec / (float(usecs_per_iterations) / n);
+    auto num_ops = n * num_nsecs_per_sec / m.median;
     if (max_num_ops == 0) max_num_ops = num_ops; // the first run will be 100%
     auto percent = float(num_ops) / float(max_num_ops);
     printf(
             "%3s: %5.1f MHz (%3.0f%%) [%7lu] ",
             label.c_str(),
             num_ops / num_usecs_per_sec,
-            percent * 100, successes
+            percent * 100, m.successes
+          );
+    stats_columns = printf(
+            "%6.2f ns (min %6.2f p99 %6.2f sd %5.2f ci +-%4.1f%%) %-8s ",
+            m.median / n, m.min / n, m.p99 / n, m.stddev / n,
+            100 * m.ci95 / m.median,
+            m.unstable() ? "UNSTABLE" : ""
           );
+    if (counters.available()) {
+        for (int i = 0; i < perf::num_counters; i++) {
+            if (c.valid[i])
+                stats_columns += printf("%s %6.2f ", perf::counter_labels[i], c.value[i] / (m.samples * n));
+            else
+                stats_columns += printf("%s    n/a ", perf::counter_labels[i]);
+        }
+    }
     draw_bar(percent);
+
+    if (!current.run.empty()) {
+        auto r = current;
+        r.target = label;
+        r.mhz = num_ops / num_usecs_per_sec;
+        r.successes = m.successes;
+        r.samples = m.samples;
+        r.median_ns = m.median / n;
+        r.min_ns = m.min / n;
+        r.p99_ns = m.p99 / n;
+        r.stddev_ns = m.stddev / n;
+        r.ci95_ns = m.ci95 / n;
+        r.unstable = m.unstable();
+        for (int i = 0; i < perf::num_counters; i++) {
+            r.counters.valid[i] = c.valid[i];
+            r.counters.value[i] = c.value[i] / (m.samples * n);
+        }
+        records.push_back(r);
+    }
     return num_ops;
 }
 
-void generate_data(std::vector<std::shared_ptr<A>>& v, Hierarchy h, unsigned int from = 7, unsigned int width = 0)
-{
-    v.reserve(n); // ensure contiguous memory
-    for(uint64_t i = 0; i < n; i++) {
-        uint64_t val = from + rand() % (width + 1);
-        if (h == Hierarchy::deep) {
-            switch(val) {
-                case  0: v.emplace_back(std::make_shared<A>()); break;
-                case  1: v.emplace_back(std::make_shared<deep::B>()); break;
-                case  2: v.emplace_back(std::make_shared<deep::C>()); break;
-                case  3: v.emplace_back(std::make_shared<deep::D>()); break;
-                case  4: v.emplace_back(std::make_shared<deep::E>()); break;
-                case  5: v.emplace_back(std::make_shared<deep::F>()); break;
-                case  6: v.emplace_back(std::make_shared<deep::G>()); break;
-                case  7: v.emplace_back(std::make_shared<deep::H>()); break;
-            }
-        } else if (h == Hierarchy::shallow) {
-            switch(val) {
-                case  0: v.emplace_back(std::make_shared<A>()); break;
-                case  1: v.emplace_back(std::make_shared<shallow::B>()); break;
-                case  2: v.emplace_back(std::make_shared<shallow::C>()); break;
-                case  3: v.emplace_back(std::make_shared<shallow::D>()); break;
-                case  4: v.emplace_back(std::make_shared<shallow::E>()); break;
-                case  5: v.emplace_back(std::make_shared<shallow::F>()); break;
-                case  6: v.emplace_back(std::make_shared<shallow::G>()); break;
-                case  7: v.emplace_back(std::make_shared<shallow::H>()); break;
-            }
-        } else if (h == Hierarchy::balanced) {
-            switch(val) {
-                case  0: v.emplace_back(std::make_shared<A>()); break;
-                case  1: v.emplace_back(std::make_shared<balanced::B>()); break;
-                case  2: v.emplace_back(std::make_shared<balanced::C>()); break;
-                case  3: v.emplace_back(std::make_shared<balanced::D>()); break;
-                case  4: v.emplace_back(std::make_shared<balanced::E>()); break;
-                case  5: v.emplace_back(std::make_shared<balanced::F>()); break;
-                case  6: v.emplace_back(std::make_shared<balanced::G>()); break;
-                case  7: v.emplace_back(std::make_shared<balanced::H>()); break;
-            }
-        }
+const char* hierarchy_name(Hierarchy h)
+{
+    switch (h) {
+        case Hierarchy::deep:           return "deep";
+        case Hierarchy::shallow:        return "shallow";
+        case Hierarchy::balanced:       return "balanced";
+        case Hierarchy::chain:          return "chain";
+        case Hierarchy::chain_multiple: return "chain_multiple";
+        case Hierarchy::chain_virtual:  return "chain_virtual";
+        case Hierarchy::binary:         return "binary";
+        case Hierarchy::wide:           return "wide";
+        case Hierarchy::comb_100:       return "comb_100";
+        case Hierarchy::comb_200:       return "comb_200";
+        case Hierarchy::comb_400:       return "comb_400";
+    }
+    return "";
+}
+
+// Heading under which the data sets of h are listed.
+const char* hierarchy_section(Hierarchy h)
+{
+    switch (h) {
+        case Hierarchy::deep:     return "deep";
+        case Hierarchy::shallow:  return "shallow";
+        case Hierarchy::balanced: return "balanced";
+        default:                  return "generated";
+    }
+}
+
+const char* layout_name(Layout l)
+{
+    switch (l) {
+        case Layout::shared_ptr:       return "shared_ptr";
+        case Layout::arena_shared_ptr: return "arena_shared_ptr";
+        case Layout::arena:            return "arena";
+        case Layout::pools:            return "pools";
+    }
+    return "";
+}
+
+const char* layout_description(Layout l)
+{
+    switch (l) {
+        case Layout::shared_ptr:       return "vector<shared_ptr<A>>, objects from make_shared";
+        case Layout::arena_shared_ptr: return "vector<shared_ptr<A>>, objects and control blocks in one arena";
+        case Layout::arena:            return "vector<A*>, objects in one arena in allocation order";
+        case Layout::pools:            return "vector<A*>, objects in one arena per class";
+    }
+    return "";
+}
+
+const char* placement_name(Placement p)
+{
+    switch (p) {
+        case Placement::heap:      return "heap";
+        case Placement::huge:      return "huge";
+        case Placement::small:     return "small";
+        case Placement::page:      return "page";
+        case Placement::scattered: return "scattered";
     }
+    return "";
 }
 
-void shuffle(std::vector<std::shared_ptr<A>>& v) {
+const char* placement_description(Placement p)
+{
+    switch (p) {
+        case Placement::heap:      return "malloc for the arenas, or make_shared";
+        case Placement::huge:      return "arenas in 2 MiB pages, madvise(MADV_HUGEPAGE)";
+        case Placement::small:     return "arenas in 4 KiB pages, madvise(MADV_NOHUGEPAGE)";
+        case Placement::page:      return "one object per 4 KiB page";
+        case Placement::scattered: return "like heap, but objects allocated in random order";
+    }
+    return "";
+}
+
+// The shared_ptr layout takes its memory from make_shared, so only the order
+// of allocation can be changed.
+bool applies(Placement p, Layout l)
+{
+    return l != Layout::shared_ptr || p == Placement::heap || p == Placement::scattered;
+}
+
+Arena::Pages arena_pages(Placement p)
+{
+    switch (p) {
+        case Placement::huge:  return Arena::Pages::huge;
+        case Placement::small: return Arena::Pages::small;
+        case Placement::page:  return Arena::Pages::one_per_page;
+        default:               return Arena::Pages::heap;
+    }
+}
+
+template<class Ptr>
+void shuffle(std::vector<Ptr>& v) {
     auto rng = std::default_random_engine { };
     std::shuffle(std::begin(v), std::end(v), rng);
 }
 
-void print_average(float num) {
-    auto avg = num / 9.0;
+// Elements 0, stride, 2 * stride, ..., then 1, stride + 1, ..., and so on.
+template<class Ptr>
+std::vector<Ptr> strided(const std::vector<Ptr>& v, unsigned int stride) {
+    std::vector<Ptr> w;
+    w.reserve(v.size());
+    for (size_t first = 0; first < stride; first++)
+        for (size_t i = first; i < v.size(); i += stride) w.push_back(v[i]);
+    return w;
+}
+
+// The objects of v, which are in allocation order unless the placement is
+// scattered, in the given order.
+template<class Ptr>
+std::vector<Ptr> arrange(const std::vector<Ptr>& v, Order o) {
+    switch (o.order) {
+        case SortOrder::aligned:
+            return v;
+        case SortOrder::shuffled: {
+            auto w = v;
+            shuffle(w);
+            return w;
+        }
+        case SortOrder::strided:
+            return strided(v, o.stride);
+    }
+    return v;
+}
+
+std::string order_name(Order o)
+{
+    switch (o.order) {
+        case SortOrder::aligned:  return "aligned";
+        case SortOrder::shuffled: return "shuffled";
+        case SortOrder::strided:  return "strided" + std::to_string(o.stride);
+    }
+    return "";
+}
+
+std::string order_description(Order o)
+{
+    switch (o.order) {
+        case SortOrder::aligned:  return "objects aligned";
+        case SortOrder::shuffled: return "objects shuffled";
+        case SortOrder::strided:  return "objects in strides of " + std::to_string(o.stride);
+    }
+    return "";
+}
+
+void print_average(float num, unsigned int count) {
+    auto avg = num / count;
     printf("------------\n");
-    printf("AVG: %5.1f MHz                  ", avg / num_usecs_per_sec);
+    printf("AVG: %5.1f MHz                  %*s", avg / num_usecs_per_sec, stats_columns, "");
     draw_bar(avg / max_num_ops, "=");
 }
 
+const char* implementation_name(Implementation i)
+{
+    switch (i) {
+        case Implementation::dynamic:  return "dynamic_cast";
+        case Implementation::priori:   return "priori_cast";
+        case Implementation::kcl:      return "kcl_dynamic_cast";
+        case Implementation::interval: return "interval_cast";
+        case Implementation::inline_cache_1: return "INLINE_CACHED_CAST(1)";
+        case Implementation::inline_cache_4: return "INLINE_CACHED_CAST(4)";
+    }
+    return "";
+}
+
+// Name of the implementation on the command line.
+const char* implementation_option(Implementation i)
+{
+    switch (i) {
+        case Implementation::dynamic:  return "dynamic";
+        case Implementation::priori:   return "priori";
+        case Implementation::kcl:      return "kcl";
+        case Implementation::interval: return "interval";
+        case Implementation::inline_cache_1: return "inline_cache_1";
+        case Implementation::inline_cache_4: return "inline_cache_4";
+    }
+    return "";
+}
+
+bool selected(Implementation i)
+{
+    return std::find(implementations.begin(), implementations.end(), i) != implementations.end();
+}
+
+// The shared_ptr casts of implementation i: those of the selected base
+// implementations, or of all four if pointer_cast is selected on its own.
+bool pointer_cast_selected(Implementation i)
+{
+    auto bases = { Implementation::dynamic, Implementation::priori, Implementation::kcl, Implementation::interval };
+    return selected(i) || std::none_of(bases.begin(), bases.end(), [](Implementation b) { return selected(b); });
+}
+
+// Labels of the targets of hierarchy h: the class names, or Ln for the
+// class at depth n of a generated hierarchy.
+std::vector<std::string> target_labels(Hierarchy h)
+{
+    unsigned int depth = 0;
+    switch (h) {
+        case Hierarchy::deep:
+        case Hierarchy::shallow:
+        case Hierarchy::balanced:
+            return { "B", "C", "D", "E", "F", "G", "H", "Z" };
+        case Hierarchy::chain:
+        case Hierarchy::chain_multiple:
+        case Hierarchy::chain_virtual:
+            depth = generated::chain.depth;
+            break;
+        case Hierarchy::binary:
+            depth = generated::binary.depth;
+            break;
+        case Hierarchy::wide:
+            depth = generated::wide.depth;
+            break;
+        case Hierarchy::comb_100:
+        case Hierarchy::comb_200:
+        case Hierarchy::comb_400:
+            depth = generated::comb_100.depth;
+            break;
+    }
+    std::vector<std::string> labels;
+    for (unsigned int d = 0; d <= depth; d++) labels.push_back("L" + std::to_string(d));
+    labels.push_back("Z");
+    return labels;
+}
+
 float dummy = 0;
-void run_benchmarks(std::vector<std::shared_ptr<A>>& v, Hierarchy h)
+
+// Validation of the implementations against dynamic_cast, before they are
+// measured.
+
+// Implementations whose results disagreed with dynamic_cast.
+unsigned int num_invalid = 0;
+
+std::string class_name(const A* p)
 {
-    float sum = 0;
+    const char* name = typeid(*p).name();
+#if defined(__GNUG__)
+    int status;
+    std::unique_ptr<char, void (*)(void*)> demangled(abi::__cxa_demangle(name, nullptr, nullptr, &status), std::free);
+    if (status == 0) return demangled.get();
+#endif
+    return name;
+}
 
-    // Cache warming
-    dummy += [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = static_cast <      A*>(e.get()); p ? s++ : dummy++; } return s; }();
+// A cast result relative to the object it was cast from.
+std::string describe(const A* from, const void* result)
+{
+    if (!result) return "null";
+    char buffer[32];
+    snprintf(buffer, sizeof buffer, "%+td", static_cast<const char*>(result) - reinterpret_cast<const char*>(from));
+    return buffer;
+}
 
-    printf("Base-line: static_cast\n");
-    printf("```\n");
-    dummy += run("-", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = static_cast <      A*>(e.get()); p ? s++ : dummy++; } return s; });
-    printf("```\n\n");
+const char* pointer_cast_name(Implementation i, Ownership o)
+{
+    switch (i) {
+        case Implementation::dynamic:  return o == Ownership::shared ? "std::dynamic_pointer_cast" : "dynamic_borrow_cast";
+        case Implementation::priori:   return o == Ownership::shared ? "priori_pointer_cast" : "priori_borrow_cast";
+        case Implementation::kcl:      return o == Ownership::shared ? "kcl_pointer_cast" : "kcl_borrow_cast";
+        case Implementation::interval: return o == Ownership::shared ? "interval_pointer_cast" : "interval_borrow_cast";
+        default: return "";
+    }
+}
 
-    if (h == Hierarchy::deep) {
-        printf("Implementation: `dynamic_cast`\n");
-        printf("```\n");
-        sum = 0;
-        dummy += run("A", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<      A*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("B", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<deep::B*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("C", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<deep::C*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("D", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<deep::D*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("E", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<deep::E*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("F", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<deep::F*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("G", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<deep::G*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("H", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<deep::H*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("Z", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<      Z*>(e.get()); p ? s++ : dummy++; } return s; });
-        print_average(sum);
-        printf("```\n");
+void pin_to_core(unsigned int core)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % std::thread::hardware_concurrency(), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+// Startup suite: runs the helpers built from startup.cpp (make startup), one
+// per implementation and number of classes, next to the benchmark.
+
+const unsigned int startup_class_counts[] = { 8, 100, 1000 };
+const Implementation startup_implementations[] = {
+    Implementation::dynamic, Implementation::priori, Implementation::kcl, Implementation::interval,
+};
+
+// Runs the program at `path` with the argument `arg` and returns what it
+// printed. False if it could not be run or did not exit with status 0.
+bool run_helper(const std::string& path, const char* arg, std::string& output)
+{
+    output.clear();
+#if defined(__linux__)
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+    char* argv[] = { const_cast<char*>(path.c_str()), const_cast<char*>(arg), nullptr };
+    pid_t pid;
+    auto error = posix_spawn(&pid, path.c_str(), &actions, nullptr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (error == 0) {
+        char buffer[256];
+        ssize_t k;
+        while ((k = read(fds[0], buffer, sizeof buffer)) > 0) output.append(buffer, k);
+    }
+    close(fds[0]);
+    int status;
+    return error == 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#else
+    return false;
+#endif
+}
+
+// The "name value" lines printed by a helper.
+std::map<std::string, double> parse_helper_output(const std::string& output)
+{
+    std::map<std::string, double> values;
+    std::istringstream lines(output);
+    std::string name;
+    double value;
+    while (lines >> name >> value) values[name] = value;
+    return values;
+}
+
+void run_startup(const std::string& program)
+{
+    auto slash = program.rfind('/');
+    auto directory = slash == std::string::npos ? std::string(".") : program.substr(0, slash);
+    auto helper = [&](Implementation i, unsigned int num_classes) {
+        return directory + "/startup_" + implementation_option(i) + "_" + std::to_string(num_classes);
+    };
+
+    printf("\n\n\n\n\n");
+    printf("## Startup\n\n");
+    printf("A helper program per implementation and number of classes, each class with up to 4 subclasses.\n");
+    printf("Process: from spawning the helper to its exit. Static init: all static initializers. First and\n");
+    printf("again: constructing and destroying an object, per class, the first time and later. Heap: allocated\n");
+    printf("by the registry until all classes were constructed. Image: executable size compared with dynamic_cast.\n");
+    current.layout = "startup";
+    current.run = "startup";
+    current.data_set = "";
+    for (auto num_classes: startup_class_counts) {
+        printf("\n\n\n\n\n");
+        printf("### %u classes\n\n", num_classes);
+        current.hierarchy = std::to_string(num_classes) + "_classes";
+
+        std::string output;
+        auto baseline = run_helper(helper(Implementation::dynamic, num_classes), "", output)
+            ? parse_helper_output(output) : std::map<std::string, double> {};
 
-        printf("Implementation: `priori_cast`\n");
-        printf("```\n");
-        sum = 0;
-        dummy += run("A", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<      A*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("B", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<deep::B*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("C", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<deep::C*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("D", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<deep::D*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("E", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<deep::E*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("F", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<deep::F*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("G", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<deep::G*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("H", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<deep::H*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("Z", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<      Z*>(e.get()); p ? s++ : dummy++; } return s; });
-        print_average(sum);
-        printf("```\n\n");
-
-        printf("Implementation: `kcl_dynamic_cast`\n");
-        printf("```\n");
-        sum = 0;
-        dummy += run("A", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<      A*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("B", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<deep::B*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("C", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<deep::C*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("D", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<deep::D*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("E", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<deep::E*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("F", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<deep::F*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("G", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<deep::G*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("H", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<deep::H*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("Z", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<      Z*>(e.get()); p ? s++ : dummy++; } return s; });
-        print_average(sum);
-        printf("```\n\n");
-
-    } else if (h == Hierarchy::shallow) {
-        printf("Implementation: `dynamic_cast`\n");
-        printf("```\n");
-        sum = 0;
-        dummy += run("A", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<         A*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("B", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<shallow::B*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("C", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<shallow::C*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("D", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<shallow::D*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("E", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<shallow::E*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("F", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<shallow::F*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("G", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<shallow::G*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("H", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<shallow::H*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("Z", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<         Z*>(e.get()); p ? s++ : dummy++; } return s; });
-        print_average(sum);
-        printf("```\n\n");
-
-        printf("Implementation: `priori_cast`\n");
-        printf("```\n");
-        sum = 0;
-        dummy += run("A", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<         A*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("B", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<shallow::B*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("C", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<shallow::C*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("D", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<shallow::D*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("E", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<shallow::E*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("F", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<shallow::F*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("G", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<shallow::G*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("H", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<shallow::H*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("Z", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<         Z*>(e.get()); p ? s++ : dummy++; } return s; });
-        print_average(sum);
-        printf("```\n\n");
-
-        printf("Implementation: `kcl_dynamic_cast`\n");
-        printf("```\n");
-        sum = 0;
-        dummy += run("A", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<         A*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("B", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<shallow::B*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("C", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<shallow::C*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("D", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<shallow::D*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("E", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<shallow::E*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("F", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<shallow::F*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("G", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<shallow::G*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("H", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<shallow::H*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("Z", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<         Z*>(e.get()); p ? s++ : dummy++; } return s; });
-        print_average(sum);
-        printf("```\n\n");
-
-    } else if (h == Hierarchy::balanced) {
-        printf("Implementation: `dynamic_cast`\n");
-        printf("```\n");
-        sum = 0;
-        dummy += run("A", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<          A*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("B", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<balanced::B*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("C", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<balanced::C*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("D", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<balanced::D*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("E", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<balanced::E*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("F", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<balanced::F*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("G", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<balanced::G*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("H", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<balanced::H*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("Z", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = dynamic_cast<          Z*>(e.get()); p ? s++ : dummy++; } return s; });
-        print_average(sum);
-        printf("```\n\n");
-
-        printf("Implementation: `priori_cast`\n");
         printf("```\n");
-        sum = 0;
-        dummy += run("A", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<          A*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("B", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<balanced::B*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("C", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<balanced::C*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("D", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<balanced::D*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("E", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<balanced::E*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("F", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<balanced::F*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("G", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<balanced::G*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("H", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<balanced::H*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("Z", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = priori_cast<          Z*>(e.get()); p ? s++ : dummy++; } return s; });
-        print_average(sum);
-        printf("```\n\n");
-
-        printf("Implementation: `kcl_dynamic_cast`\n");
+        printf("implementation      process  (ci)      static init    first    again     heap      image  object\n");
+        for (auto i: startup_implementations) {
+            if (!selected(i)) continue;
+            auto path = helper(i, num_classes);
+            if (!run_helper(path, "", output)) {
+                printf("%-16s  %s did not run, see make startup\n", implementation_name(i), path.c_str());
+                continue;
+            }
+            auto v = parse_helper_output(output);
+
+            std::vector<double> static_init;
+            auto m = timing::measure([&] {
+                run_helper(path, "--exit", output);
+                static_init.push_back(parse_helper_output(output)["static_init_ticks"]);
+                return uint64_t(1);
+            }, num_warmup_passes, num_samples);
+            std::sort(static_init.begin(), static_init.end());
+
+            auto ns = timing::ns_per_tick();
+            printf("%-16s %8.3f ms (+-%4.1f%%) %8.2f us %8.1f ns %6.1f ns %6.0f B %+8.0f B %5.0f B\n",
+                    implementation_name(i), m.median / 1e6, 100 * m.ci95 / m.median,
+                    static_init[static_init.size() / 2] * ns / 1e3,
+                    v["first_ticks"] * ns / num_classes, v["construction_ticks"] * ns / num_classes,
+                    v["init_heap_bytes"] + v["first_heap_bytes"],
+                    baseline.empty() ? NAN : v["image_bytes"] - baseline["image_bytes"],
+                    v["object_bytes"]);
+
+            auto r = current;
+            r.implementation = implementation_name(i);
+            r.target = "process";
+            r.successes = 1;
+            r.samples = m.samples;
+            r.mhz = 1e3 / m.median;
+            r.median_ns = m.median;
+            r.min_ns = m.min;
+            r.p99_ns = m.p99;
+            r.stddev_ns = m.stddev;
+            r.ci95_ns = m.ci95;
+            r.unstable = m.unstable();
+            records.push_back(r);
+        }
         printf("```\n");
-        sum = 0;
-        dummy += run("A", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<          A*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("B", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<balanced::B*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("C", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<balanced::C*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("D", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<balanced::D*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("E", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<balanced::E*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("F", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<balanced::F*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("G", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<balanced::G*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("H", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<balanced::H*>(e.get()); p ? s++ : dummy++; } return s; });
-        sum   += run("Z", [&v]() -> uint64_t { auto s = 0; for (auto& e: v) { auto *p = kcl_dynamic_cast<          Z*>(e.get()); p ? s++ : dummy++; } return s; });
-        print_average(sum);
-        printf("```\n\n");
     }
 }
 
@@ -364,90 +584,520 @@ struct JustKclRtti {
 };
 KCL_RTTI_REGISTER(JustKclRtti);
 
-std::vector<std::shared_ptr<A>> vec_deep_successful;
-std::vector<std::shared_ptr<A>> vec_deep_fails;
+// Whether the data set is one of those selected on the command line.
+template<class DataSet>
+bool selected(const DataSet& d)
+{
+    return std::find(hierarchies.begin(), hierarchies.end(), d.h) != hierarchies.end()
+        && std::find(data_set_names.begin(), data_set_names.end(), d.name) != data_set_names.end();
+}
 
-std::vector<std::shared_ptr<A>> vec_shallow_successful;
-std::vector<std::shared_ptr<A>> vec_shallow_fails;
+// Runs `benchmark` on every selected data set in the given order, with
+// headings.
+template<class Ptr, class Benchmark>
+void run_data_sets(DataSets<Ptr>& data, Benchmark benchmark, Order order)
+{
+    std::string section;
+    for (auto& d: data.all()) {
+        if (!selected(d)) continue;
+        if (section != hierarchy_section(d.h)) {
+            if (!section.empty()) printf("\n\n\n\n\n");
+            section = hierarchy_section(d.h);
+            printf("### Class hierarchy: %s\n\n", section.c_str());
+        }
+        printf("#### %s\n\n", d.heading);
+        current.hierarchy = hierarchy_name(d.h);
+        current.data_set = d.name;
+        if (order.order == SortOrder::aligned) {
+            benchmark(*d.v, d.h);
+        } else {
+            auto v = arrange(*d.v, order);
+            benchmark(v, d.h);
+        }
+    }
+}
 
-std::vector<std::shared_ptr<A>> vec_deep_mixed;
-std::vector<std::shared_ptr<A>> vec_shallow_mixed;
-std::vector<std::shared_ptr<A>> vec_balanced_mixed;
+// Memory of the process in transparent huge pages, or -1 if unknown.
+int64_t huge_page_bytes()
+{
+#if defined(__linux__)
+    std::ifstream smaps("/proc/self/smaps_rollup");
+    std::string name;
+    int64_t kb;
+    while (smaps >> name) {
+        if (name == "AnonHugePages:" && smaps >> kb) return kb << 10;
+        smaps.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+#endif
+    return -1;
+}
 
-int main()
+// Generates the data sets in the given layout and benchmarks them: in
+// single-threaded runs of the casts or of the dispatch suite, or in the
+// scaling or registry mode. The construction suite makes objects of its own instead.
+template<class Ptr>
+void run_layout(Layout layout, Mode mode)
 {
-    generate_data(vec_deep_successful, Hierarchy::deep, 6, 0);
-    generate_data(vec_deep_fails, Hierarchy::deep, 1, 0);
-    generate_data(vec_deep_mixed, Hierarchy::deep, 0, 6);
+    printf("\n\n\n\n\n");
+    printf("# Layout: %s (%s)\n", layout_name(layout), layout_description(layout));
+    current.layout = layout_name(layout);
+    if (placement != Placement::heap) {
+        printf("\nPlacement: %s (%s)\n", placement_name(placement), placement_description(placement));
+        current.layout += std::string("@") + placement_name(placement);
+    }
+    if (!applies(placement, layout)) {
+        printf("Does not apply to this layout.\n");
+        return;
+    }
 
-    generate_data(vec_shallow_successful, Hierarchy::shallow, 6, 0);
-    generate_data(vec_shallow_fails, Hierarchy::shallow, 1, 0);
-    generate_data(vec_shallow_mixed, Hierarchy::shallow, 0, 6);
+    if (mode == Mode::construction) {
+        run_construction<Ptr>(layout);
+        return;
+    }
+
+    DataSets<Ptr> data(layout);
 
-    generate_data(vec_balanced_mixed, Hierarchy::balanced, 0, 6);
+    // Same sequence of classes in every layout, whichever data sets are
+    // selected.
+    unsigned int seed = 1;
+    for (auto& d: data.all()) {
+        srand(seed++);
+        if (selected(d)) generate_data(data, *d.v, d.h, d.from, d.width);
+    }
+    auto huge_pages = huge_page_bytes();
+    if (huge_pages >= 0) printf("\nTransparent huge pages of the process: %.1f MiB\n", huge_pages / double(1 << 20));
 
-    // Run the benchmark loop 3 times:
-    // 1st: Warming up, discard.
-    // 2nd: Objects are ordered in memory
-    // 3rd: Objects are shuffled in memory
-    for (unsigned int i = 0; i < 3; i++) {
+    if (mode == Mode::scaling) {
+        printf("\n\n\n\n\n");
+        printf("## Scaling (%s, %u hardware threads)\n\n", order_description(orders.front()).c_str(), std::thread::hardware_concurrency());
+        run_data_sets(data, [](auto& v, Hierarchy h) { run_scaling_benchmarks(v, h); }, orders.front());
+        return;
+    }
+
+    if (mode == Mode::registry) {
+        printf("\n\n\n\n\n");
+        printf("## Runtime type registry (%s, %u hardware threads)\n\n", order_description(orders.front()).c_str(), std::thread::hardware_concurrency());
+        printf("Casts per second of all reader threads: with interval_cast, with TypeRegistry while no class is\n");
+        printf("added, and while one more thread keeps adding and removing classes below A (up to %u at a time).\n", max_plugins);
+        printf("Change: of the throughput while adding. Changes/s and latency: of the adding thread.\n");
+        printf("Up to hardware_concurrency - 1 reader threads, so that the adding thread has a core of its own.\n\n");
+        run_data_sets(data, [](auto& v, Hierarchy h) { run_registry(v, h); }, orders.front());
+        return;
+    }
+
+    // Run 0 warms up in the first order and is discarded, then one run per
+    // order, by default:
+    // Run 1: Objects are ordered in memory
+    // Run 2: Objects are shuffled in memory
+    for (unsigned int i = 0; i <= orders.size(); i++) {
         max_num_ops = 0;
 
         printf("\n\n\n\n\n");
 
-        switch(i) {
-            case 0:
-                printf("## Run 0 (discard)\n\n");
-                break;
-            case 1:
-                printf("## Run 1 (objects aligned)\n\n");
-                break;
-            case 2:
-                printf("## Run 2 (objects shuffled)\n\n");
-
-                shuffle(vec_deep_successful);
-                shuffle(vec_deep_fails);
-                shuffle(vec_deep_mixed);
-                shuffle(vec_shallow_successful);
-                shuffle(vec_shallow_fails);
-                shuffle(vec_shallow_mixed);
-                shuffle(vec_balanced_mixed);
+        auto order = orders[i == 0 ? 0 : i - 1];
+        if (i == 0) {
+            printf("## Run 0 (discard)\n\n");
+            current.run = "";
+        } else {
+            printf("## Run %u (%s)\n\n", i, order_description(order).c_str());
+            current.run = order_name(order);
         }
 
-        printf("### Class hierarchy: deep\n\n");
+        if (mode == Mode::dispatch)
+            run_data_sets(data, [](auto& v, Hierarchy h) { run_dispatch(v, h); }, order);
+        else
+            run_data_sets(data, [](auto& v, Hierarchy h) { run_benchmarks(v, h); }, order);
+    }
+}
 
-        printf("#### Cast type: Mostly successful (cast from class G)\n\n");
-        run_benchmarks(vec_deep_successful, Hierarchy::deep);
+// Throughput and dTLB misses per cast, averaged over the records of each
+// layout, placement and run.
+void print_placements()
+{
+    struct Sum {
+        std::string layout, run;
+        double mhz { 0 }, tlb { 0 };
+        unsigned int count { 0 }, tlb_count { 0 };
+    };
+    std::vector<Sum> sums;
+    for (auto& r: records) {
+        auto s = std::find_if(sums.begin(), sums.end(), [&](const Sum& s) { return s.layout == r.layout && s.run == r.run; });
+        if (s == sums.end()) s = sums.insert(sums.end(), Sum { r.layout, r.run });
+        s->mhz += r.mhz;
+        s->count++;
+        if (r.counters.valid[perf::dtlb_misses]) {
+            s->tlb += r.counters.value[perf::dtlb_misses];
+            s->tlb_count++;
+        }
+    }
 
-        printf("#### Cast type: Mostly failed (cast from class B)\n\n");
-        run_benchmarks(vec_deep_fails, Hierarchy::deep);
+    printf("\n\n\n\n\n");
+    printf("# Placements\n\n");
+    printf("Averages over all measurements of a run: casts per second, and dTLB read misses per cast.\n\n");
+    printf("```\n");
+    printf("layout                      run            MHz      tlb\n");
+    for (auto& s: sums) {
+        printf("%-27s %-10s %8.1f ", s.layout.c_str(), s.run.c_str(), s.mhz / s.count);
+        if (s.tlb_count) printf("%8.4f\n", s.tlb / s.tlb_count);
+        else printf("     n/a\n");
+    }
+    printf("```\n");
+}
 
-        printf("#### Cast type: Mixed (cast from random classes)\n\n");
-        run_benchmarks(vec_deep_mixed, Hierarchy::deep);
+// Time per cast on the hierarchies of the size series, by number of classes:
+// averages over the targets of each layout, run and implementation.
+void print_sizes()
+{
+    constexpr Hierarchy series[] = { Hierarchy::comb_100, Hierarchy::comb_200, Hierarchy::comb_400 };
+    constexpr uint32_t sizes[] = { gen::size(generated::comb_100), gen::size(generated::comb_200), gen::size(generated::comb_400) };
+    constexpr int num_sizes = std::size(series);
 
+    struct Sum {
+        std::string layout, run, implementation;
+        double ns[num_sizes] {};
+        unsigned int count[num_sizes] {};
+    };
+    std::vector<Sum> sums;
+    for (auto& r: records) {
+        auto k = std::find_if(std::begin(series), std::end(series), [&](Hierarchy h) { return r.hierarchy == hierarchy_name(h); }) - std::begin(series);
+        if (k == num_sizes) continue;
+        auto s = std::find_if(sums.begin(), sums.end(), [&](const Sum& s) {
+            return s.layout == r.layout && s.run == r.run && s.implementation == r.implementation;
+        });
+        if (s == sums.end()) s = sums.insert(sums.end(), Sum { r.layout, r.run, r.implementation });
+        s->ns[k] += r.median_ns;
+        s->count[k]++;
+    }
+    if (sums.empty()) return;
 
-        printf("\n\n\n\n\n");
-        printf("### Class hierarchy: shallow\n\n");
+    printf("\n\n\n\n\n");
+    printf("# Hierarchy size\n\n");
+    printf("Time per cast in ns on the combs of depth 12, averaged over the targets, by number of classes.\n\n");
+    printf("```\n");
+    printf("%-27s %-10s %-28s", "layout", "run", "implementation");
+    for (auto size: sizes) printf(" %5u classes", size);
+    printf("\n");
+    for (auto& s: sums) {
+        printf("%-27s %-10s %-28s", s.layout.c_str(), s.run.c_str(), s.implementation.c_str());
+        for (int k = 0; k < num_sizes; k++) {
+            if (s.count[k]) printf(" %13.3f", s.ns[k] / s.count[k]);
+            else printf(" %13s", "n/a");
+        }
+        printf("\n");
+    }
+    printf("```\n");
+}
 
-        printf("#### Cast type: Mostly successful (cast from class G)\n\n");
-        run_benchmarks(vec_shallow_successful, Hierarchy::shallow);
+// Prints the records that changed significantly against the baseline.
+// Returns the number of regressions.
+unsigned int compare_with_baseline(const std::string& path, const std::vector<results::Record>& baseline, double threshold)
+{
+    std::map<std::string, const results::Record*> by_key;
+    for (auto& r: baseline) by_key[r.key()] = &r;
 
-        printf("#### Cast type: Mostly failed (cast from class B)\n\n");
-        run_benchmarks(vec_shallow_fails, Hierarchy::shallow);
+    unsigned int num_compared = 0, num_regressions = 0, num_improvements = 0, num_missing = 0, num_different = 0;
+    printf("\n\n\n\n\n");
+    printf("# Comparison with %s (threshold %.1f%%)\n\n", path.c_str(), threshold * 100);
+    printf("```\n");
+    for (auto& r: records) {
+        auto b = by_key.find(r.key());
+        if (b == by_key.end()) {
+            num_missing++;
+            continue;
+        }
+        if (b->second->successes != r.successes) {
+            // Not the same data, e.g. another n.
+            num_different++;
+            continue;
+        }
+        num_compared++;
+        auto regression = results::regressed(*b->second, r, threshold);
+        auto improvement = results::improved(*b->second, r, threshold);
+        if (regression) num_regressions++;
+        if (improvement) num_improvements++;
+        if (regression || improvement)
+            printf("%-11s %+6.1f%%  %6.2f ns -> %6.2f ns  %s\n",
+                    regression ? "REGRESSION" : "improvement",
+                    results::change(*b->second, r) * 100, b->second->median_ns, r.median_ns, r.key().c_str());
+    }
+    printf("%u compared: %u regressions, %u improvements; %u not in the baseline, %u with other success counts\n",
+            num_compared, num_regressions, num_improvements, num_missing, num_different);
+    printf("```\n");
+    return num_regressions;
+}
 
-        printf("#### Cast type: Mixed (cast from random classes)\n\n");
-        run_benchmarks(vec_shallow_mixed, Hierarchy::shallow);
+void usage(const char* program)
+{
+    printf("Usage: %s [--scaling | --dispatch | --construction | --startup | --registry]\n", program);
+    printf("       [--layout NAME]...\n");
+    printf("       [--csv FILE] [--json FILE]\n");
+    printf("       [--compare BASELINE.csv [--threshold PERCENT]] [workload options]\n\n");
+    printf("  --scaling      Cast from 1 to hardware_concurrency threads, pinned to cores,\n");
+    printf("                 instead of running the single-threaded benchmark.\n");
+    printf("  --dispatch     Instead of single casts, find out which class of its hierarchy\n");
+    printf("                 each object is and call a handler for it, with if-chains of\n");
+    printf("                 casts, a visitor, std::variant and a handler table.\n");
+    printf("  --construction Make and destroy objects of every class, like the data sets of\n");
+    printf("                 the layout, with 1 to hardware_concurrency threads.\n");
+    printf("  --startup      Run the startup_* helpers (make startup) for process startup,\n");
+    printf("                 static initialization, first construction and registry memory\n");
+    printf("                 of each implementation with 8, 100 and 1000 classes.\n");
+    printf("  --registry     Cast with a runtime type registry from 1 to hardware_concurrency - 1\n");
+    printf("                 threads while one more thread adds and removes classes.\n");
+    printf("                 Default data set: deep, mixed.\n");
+    printf("  --layout NAME  Store the objects in this layout. May be repeated. Default: all.\n");
+    for (auto l: { Layout::shared_ptr, Layout::arena_shared_ptr, Layout::arena, Layout::pools })
+        printf("                   %-17s %s\n", layout_name(l), layout_description(l));
+    printf("  --placement NAME  Place the objects in memory like this, all layouts once per\n");
+    printf("                 --placement. Default: heap.\n");
+    for (auto p: { Placement::heap, Placement::huge, Placement::small, Placement::page, Placement::scattered })
+        printf("                   %-17s %s\n", placement_name(p), placement_description(p));
+    printf("                 huge, small and page do not apply to the shared_ptr layout, and\n");
+    printf("                 page takes 4 KiB per object: it makes at most %luK objects\n", max_page_elements >> 10);
+    printf("                 per data set.\n");
+    printf("  --csv FILE     Write one record per measurement of runs 1, 2, ... as CSV.\n");
+    printf("  --json FILE    Same as a JSON array.\n");
+    printf("  --compare FILE Compare with a CSV file of an earlier run, and exit with\n");
+    printf("                 status 2 if a measurement is slower by more than the threshold\n");
+    printf("                 and outside of both 95%% confidence intervals.\n");
+    printf("                 Exit status 3 if an implementation disagreed with dynamic_cast\n");
+    printf("                 and there was no such regression.\n");
+    printf("  --threshold PERCENT  For --compare. Default: 5.\n\n");
+    printf("Workload:\n");
+    printf("  --elements N   Objects per data set, 1K to 1G (K, M, G are powers of 1024).\n");
+    printf("                 Default: %lu.\n", default_n);
+    printf("  --distribution uniform|zipf[:S]\n");
+    printf("                 Of the classes in the mixed data sets. With zipf, the k-th class\n");
+    printf("                 (from the root) is drawn in proportion to 1 / k^S. Default: uniform, S = 1.\n");
+    printf("  --order aligned|shuffled|strided:K\n");
+    printf("                 Order in which the objects are cast: allocation order, random, or\n");
+    printf("                 every K-th object in K passes. One run per --order.\n");
+    printf("                 Default: aligned, then shuffled.\n");
+    printf("  --hierarchy NAME       Run only these hierarchies. May be repeated:\n");
+    printf("                 ");
+    for (auto h: all_hierarchies) printf(" %s", hierarchy_name(h));
+    printf("\n");
+    printf("  --data-set NAME        Run only these data sets: successful, fails, mixed.\n");
+    printf("  --implementation NAME  Run only these implementations. May be repeated:\n");
+    printf("                 ");
+    for (auto i: all_implementations) printf(" %s", implementation_option(i));
+    printf(" batched bucketed\n");
+    printf("                 pointer_cast (of those of dynamic, priori, kcl, interval that are\n");
+    printf("                 selected, or of all four)\n");
+    printf("  --samples N    Timed passes per measurement, 1 to 1000. Default: %u.\n", default_num_samples);
+    printf("  --warmups N    Untimed passes before each measurement, 0 to 1000. Default: %u.\n", default_num_warmup_passes);
+}
 
+// Parses e.g. "1000", "64K" or "1G".
+bool parse_count(const std::string& s, uint64_t& count)
+{
+    char* end;
+    count = strtoull(s.c_str(), &end, 10);
+    if (end == s.c_str()) return false;
+    std::string suffix = end;
+    if (suffix == "K") count <<= 10;
+    else if (suffix == "M") count <<= 20;
+    else if (suffix == "G") count <<= 30;
+    else if (!suffix.empty()) return false;
+    return true;
+}
 
-        printf("\n\n\n\n\n");
-        printf("### Class hierarchy: balanced\n\n");
+// Parses a plain decimal number from `min` to `max`, e.g. "10".
+bool parse_number(const std::string& s, unsigned int min, unsigned int max, unsigned int& value)
+{
+    if (s.empty() || !isdigit(static_cast<unsigned char>(s[0]))) return false;
+    char* end;
+    auto v = strtoul(s.c_str(), &end, 10);
+    if (*end != '\0' || v < min || v > max) return false;
+    value = v;
+    return true;
+}
+
+bool parse_order(const std::string& s, Order& o)
+{
+    if (s == "aligned") o = { SortOrder::aligned, 0 };
+    else if (s == "shuffled") o = { SortOrder::shuffled, 0 };
+    else if (s.rfind("strided:", 0) == 0 && atoi(s.c_str() + 8) > 0) o = { SortOrder::strided, unsigned(atoi(s.c_str() + 8)) };
+    else return false;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    Mode mode = Mode::casts;
+    std::vector<Layout> layouts;
+    std::string csv_path, json_path, baseline_path;
+    double threshold = 0.05;
+    std::vector<Order> selected_orders;
+    std::vector<Placement> selected_placements;
+    std::vector<Hierarchy> selected_hierarchies;
+    std::vector<std::string> selected_data_sets;
+    std::vector<std::string> implementation_names;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool ok = true;
+        if (arg == "--help") {
+            usage(argv[0]);
+            return 0;
+        } else if (arg == "--scaling") {
+            mode = Mode::scaling;
+        } else if (arg == "--dispatch") {
+            mode = Mode::dispatch;
+        } else if (arg == "--construction") {
+            mode = Mode::construction;
+        } else if (arg == "--startup") {
+            mode = Mode::startup;
+        } else if (arg == "--registry") {
+            mode = Mode::registry;
+        } else if (i + 1 == argc) {
+            ok = false;
+        } else if (arg == "--csv") {
+            csv_path = argv[++i];
+        } else if (arg == "--json") {
+            json_path = argv[++i];
+        } else if (arg == "--compare") {
+            baseline_path = argv[++i];
+        } else if (arg == "--threshold") {
+            threshold = atof(argv[++i]) / 100;
+        } else if (arg == "--layout") {
+            std::string name = argv[++i];
+            auto all = { Layout::shared_ptr, Layout::arena_shared_ptr, Layout::arena, Layout::pools };
+            auto l = std::find_if(all.begin(), all.end(), [&](Layout l) { return name == layout_name(l); });
+            ok = l != all.end();
+            if (ok) layouts.push_back(*l);
+        } else if (arg == "--elements") {
+            ok = parse_count(argv[++i], n) && n >= 1 << 10 && n <= 1 << 30;
+        } else if (arg == "--distribution") {
+            std::string name = argv[++i];
+            if (name == "uniform") {
+                distribution = Distribution::uniform;
+            } else if (name == "zipf" || name.rfind("zipf:", 0) == 0) {
+                distribution = Distribution::zipf;
+                if (name.size() > 5) zipf_exponent = atof(name.c_str() + 5);
+                ok = zipf_exponent > 0;
+            } else {
+                ok = false;
+            }
+        } else if (arg == "--placement") {
+            std::string name = argv[++i];
+            auto all = { Placement::heap, Placement::huge, Placement::small, Placement::page, Placement::scattered };
+            auto p = std::find_if(all.begin(), all.end(), [&](Placement p) { return name == placement_name(p); });
+            ok = p != all.end();
+            if (ok) selected_placements.push_back(*p);
+        } else if (arg == "--order") {
+            Order o;
+            ok = parse_order(argv[++i], o);
+            selected_orders.push_back(o);
+        } else if (arg == "--hierarchy") {
+            std::string name = argv[++i];
+            auto h = std::find_if(std::begin(all_hierarchies), std::end(all_hierarchies), [&](Hierarchy h) { return name == hierarchy_name(h); });
+            ok = h != std::end(all_hierarchies);
+            if (ok) selected_hierarchies.push_back(*h);
+        } else if (arg == "--data-set") {
+            std::string name = argv[++i];
+            ok = name == "successful" || name == "fails" || name == "mixed";
+            selected_data_sets.push_back(name);
+        } else if (arg == "--implementation") {
+            implementation_names.push_back(argv[++i]);
+        } else if (arg == "--samples") {
+            ok = parse_number(argv[++i], 1, 1000, num_samples);
+        } else if (arg == "--warmups") {
+            ok = parse_number(argv[++i], 0, 1000, num_warmup_passes);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!selected_orders.empty()) orders = selected_orders;
+    if (!selected_placements.empty()) placements = selected_placements;
+    if (!selected_hierarchies.empty()) hierarchies = selected_hierarchies;
+    else if (mode == Mode::registry) hierarchies = { Hierarchy::deep };
+    if (!selected_data_sets.empty()) data_set_names = selected_data_sets;
+    else if (mode == Mode::registry) data_set_names = { "mixed" };
+    if (!implementation_names.empty()) {
+        implementations.clear();
+        batched = false;
+        bucketed = false;
+        pointer_casts = false;
+        for (auto& name: implementation_names) {
+            auto i = std::find_if(std::begin(all_implementations), std::end(all_implementations), [&](Implementation i) { return name == implementation_option(i); });
+            if (i != std::end(all_implementations)) {
+                implementations.push_back(*i);
+            } else if (name == "batched") {
+                batched = true;
+            } else if (name == "bucketed") {
+                bucketed = true;
+            } else if (name == "pointer_cast") {
+                pointer_casts = true;
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+    }
+    std::vector<results::Record> baseline;
+    if (!baseline_path.empty() && !results::read_csv(baseline_path, baseline)) {
+        fprintf(stderr, "%s: not a CSV file written with --csv\n", baseline_path.c_str());
+        return 1;
+    }
+
+    if (counters.available())
+        printf("Hardware counters per cast: cycles (cyc), instructions (ins), branch misses (brm), "
+               "L1d read misses (l1d), LLC read misses (llc), dTLB read misses (tlb)\n");
+    else
+        printf("Hardware counters not available: %s\n", counters.unavailable_reason().c_str());
+
+    if (layouts.empty())
+        layouts = { Layout::shared_ptr, Layout::arena_shared_ptr, Layout::arena, Layout::pools };
 
-        printf("#### Cast type: Mixed (cast from random classes)\n\n");
-        run_benchmarks(vec_balanced_mixed, Hierarchy::balanced);
+    // Until the process starts a thread, libstdc++ updates the reference
+    // counts of shared_ptr without atomic instructions (see
+    // __libc_single_threaded). Start one, so that the single-threaded runs
+    // measure the atomic updates of a multithreaded program, as --scaling
+    // does.
+    std::thread([] {}).join();
+
+    if (mode == Mode::startup) {
+        run_startup(argv[0]);
+    } else {
+        auto elements = n;
+        for (auto p: placements) {
+            placement = p;
+            n = elements;
+            if (p == Placement::page && n > max_page_elements) {
+                n = max_page_elements;
+                printf("\nPlacement page: %lu objects per data set instead of %lu, as each takes 4 KiB.\n", n, elements);
+            }
+            for (auto layout: layouts) {
+                if (layout == Layout::shared_ptr || layout == Layout::arena_shared_ptr)
+                    run_layout<std::shared_ptr<A>>(layout, mode);
+                else
+                    run_layout<A*>(layout, mode);
+            }
+        }
+        n = elements;
+        if (placements.size() > 1) print_placements();
+        print_sizes();
     }
 
     printf("\n\n\n\n\n");
     std::cout << "sizeof JustKclRtti: " << sizeof(JustKclRtti) << "\n";
     std::cout << "sizeof A: " << sizeof(A) << "\n";
     printf("%f", dummy);
+
+    if (!csv_path.empty() && !results::write_csv(csv_path, records))
+        fprintf(stderr, "%s: could not be written\n", csv_path.c_str());
+    if (!json_path.empty() && !results::write_json(json_path, records))
+        fprintf(stderr, "%s: could not be written\n", json_path.c_str());
+    // The comparison runs in any case, and a regression takes precedence
+    // over invalid implementations in the exit status.
+    unsigned int num_regressions = 0;
+    if (!baseline_path.empty()) num_regressions = compare_with_baseline(baseline_path, baseline, threshold);
+    if (num_invalid > 0)
+        fprintf(stderr, "%u implementation runs disagreed with dynamic_cast and were not measured\n", num_invalid);
+    if (num_regressions > 0) return 2;
+    if (num_invalid > 0) return 3;
 }
@@ -0,0 +1,11 @@
+/*
+ * The objects of the largest generated hierarchy for the shared_ptr layouts.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#include <memory>
+
+#include "generated_data.h"
+
+INSTANTIATE_MAKE_GENERATED(comb_400, std::shared_ptr<A>)
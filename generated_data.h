@@ -0,0 +1,30 @@
+/*
+ * Construction of the objects of the generated hierarchies, for the data
+ * sets. Instantiated in generated_*.cpp, the largest hierarchy in a
+ * translation unit of its own for shared_ptr, where it takes longest.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#pragma once
+
+#include <array>
+#include <utility>
+
+#include "benchmark.h"
+
+template<gen::Shape S, class Ptr>
+Ptr make_generated(DataSets<Ptr>& data, uint32_t i)
+{
+    using Factory = Ptr (*)(DataSets<Ptr>&);
+    static const auto factories = []<uint32_t... I>(std::integer_sequence<uint32_t, I...>) {
+        return std::array<Factory, sizeof...(I)> {
+            [](DataSets<Ptr>& data) { return data.template make<generated::Node<S, I>>(); }...
+        };
+    }(std::make_integer_sequence<uint32_t, gen::size(S)>());
+    return factories[i](data);
+}
+
+// Explicit instantiation for generated::shape.
+#define INSTANTIATE_MAKE_GENERATED(shape, Ptr) \
+    template Ptr make_generated<generated::shape>(DataSets<Ptr>&, uint32_t);
@@ -0,0 +1,16 @@
+/*
+ * The objects of the generated hierarchies for the arena and pools layouts.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#include "generated_data.h"
+
+INSTANTIATE_MAKE_GENERATED(chain, A*)
+INSTANTIATE_MAKE_GENERATED(chain_multiple, A*)
+INSTANTIATE_MAKE_GENERATED(chain_virtual, A*)
+INSTANTIATE_MAKE_GENERATED(binary, A*)
+INSTANTIATE_MAKE_GENERATED(wide, A*)
+INSTANTIATE_MAKE_GENERATED(comb_100, A*)
+INSTANTIATE_MAKE_GENERATED(comb_200, A*)
+INSTANTIATE_MAKE_GENERATED(comb_400, A*)
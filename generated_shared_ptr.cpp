@@ -0,0 +1,18 @@
+/*
+ * The objects of the generated hierarchies for the shared_ptr layouts, but
+ * for comb_400, see generated_comb_400.cpp.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#include <memory>
+
+#include "generated_data.h"
+
+INSTANTIATE_MAKE_GENERATED(chain, std::shared_ptr<A>)
+INSTANTIATE_MAKE_GENERATED(chain_multiple, std::shared_ptr<A>)
+INSTANTIATE_MAKE_GENERATED(chain_virtual, std::shared_ptr<A>)
+INSTANTIATE_MAKE_GENERATED(binary, std::shared_ptr<A>)
+INSTANTIATE_MAKE_GENERATED(wide, std::shared_ptr<A>)
+INSTANTIATE_MAKE_GENERATED(comb_100, std::shared_ptr<A>)
+INSTANTIATE_MAKE_GENERATED(comb_200, std::shared_ptr<A>)
@@ -0,0 +1,174 @@
+/*
+ * Compile-time arithmetic for synthetic class hierarchies.
+ *
+ * A Shape is a full tree of the given depth in which every class has
+ * `fanout` subclasses, or a comb, in which only the leftmost class at each
+ * depth has subclasses, so that the number of classes grows linearly with
+ * the fanout at a given depth. Classes are numbered in pre-order, so class 0
+ * is the root, and class k is the leftmost class at depth k. The class templates
+ * themselves are defined by the user of this header, as e.g.
+ *
+ *     template<gen::Shape S, uint32_t I> struct Node : Node<S, gen::parent(S, I)> { ... };
+ *
+ * GEN_REPEAT(M, x, h, t, u) expands M(x, 0) M(x, 1) ... M(x, N - 1), for
+ * registration macros that have to be written out for every class. The
+ * preprocessor cannot count, so N = 100 h + 10 t + u is given as its decimal
+ * digits, e.g. GEN_REPEAT(M, x, 0, 7, 3) for 73 classes; h goes up to 10.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "interval_cast.h"
+
+namespace gen {
+
+enum class Inheritance {
+    single,   // class : parent
+    multiple, // class : other base, parent
+    virtual_, // class : virtual parent
+};
+
+struct Shape {
+    unsigned int depth;
+    unsigned int fanout;
+    Inheritance inheritance;
+    bool comb { false };
+};
+
+// Number of classes in a subtree whose root is at the given depth, and the
+// leftmost class there or not.
+constexpr uint32_t subtree_size(Shape s, unsigned int depth, bool leftmost = true)
+{
+    if (s.comb) return leftmost ? 1 + (s.depth - depth) * s.fanout : 1;
+    uint32_t size = 0, level = 1;
+    for (unsigned int d = depth; d <= s.depth; d++) {
+        size += level;
+        level *= s.fanout;
+    }
+    return size;
+}
+
+constexpr uint32_t size(Shape s) { return subtree_size(s, 0); }
+
+// Depth of class i, and its direct base class (0 for the root itself).
+struct Position {
+    unsigned int depth;
+    uint32_t parent;
+};
+
+constexpr Position position(Shape s, uint32_t i)
+{
+    uint32_t node = 0;
+    unsigned int depth = 0;
+    uint32_t parent = 0;
+    while (node != i) {
+        auto child = node + 1;
+        auto child_size = subtree_size(s, depth + 1, child == depth + 1);
+        while (i >= child + child_size) {
+            child += child_size;
+            child_size = subtree_size(s, depth + 1, false);
+        }
+        parent = node;
+        node = child;
+        depth++;
+    }
+    return { depth, parent };
+}
+
+constexpr unsigned int depth(Shape s, uint32_t i) { return position(s, i).depth; }
+constexpr uint32_t parent(Shape s, uint32_t i) { return position(s, i).parent; }
+
+// Number of classes in the subtree of class i.
+constexpr uint32_t subtree_size_of(Shape s, uint32_t i)
+{
+    auto d = depth(s, i);
+    return subtree_size(s, d, i == d);
+}
+
+template<class U, Shape S, template<Shape, uint32_t> class N>
+struct NodeIndex {
+    static constexpr bool found = false;
+    static constexpr uint32_t value = 0;
+};
+
+template<Shape S, template<Shape, uint32_t> class N, uint32_t I>
+struct NodeIndex<N<S, I>, S, N> {
+    static constexpr bool found = true;
+    static constexpr uint32_t value = I;
+};
+
+// Stands in for the classes N<S, 0..size(S) - 1> in an interval::Node tree.
+template<Shape S, template<Shape, uint32_t> class N>
+struct IntervalSubtree {
+    static constexpr uint32_t size = gen::size(S);
+
+    template<class U>
+    static constexpr interval::Range find(uint32_t first = 0) {
+        using Index = NodeIndex<U, S, N>;
+        if constexpr (Index::found) {
+            auto i = first + Index::value;
+            return { i, i + subtree_size_of(S, Index::value) - 1 };
+        } else {
+            return interval::no_range;
+        }
+    }
+
+    static constexpr void ranges(interval::Range* out, uint32_t first = 0) {
+        for (uint32_t i = 0; i < size; i++) out[first + i] = { first + i, first + i + subtree_size_of(S, i) - 1 };
+    }
+};
+
+} // namespace gen
+
+#define GEN_REPEAT(M, x, h, t, u) \
+    GEN_REPEAT_HUNDREDS_##h(M, x, 0) \
+    GEN_REPEAT_TENS_##t(M, x, (h) * 100) \
+    GEN_REPEAT_UNITS_##u(M, x, (h) * 100 + (t) * 10)
+
+#define GEN_REPEAT_1(M, x, i)  M(x, i)
+#define GEN_REPEAT_2(M, x, i)  GEN_REPEAT_1(M, x, i)  GEN_REPEAT_1(M, x, (i) + 1)
+#define GEN_REPEAT_4(M, x, i)  GEN_REPEAT_2(M, x, i)  GEN_REPEAT_2(M, x, (i) + 2)
+#define GEN_REPEAT_8(M, x, i)  GEN_REPEAT_4(M, x, i)  GEN_REPEAT_4(M, x, (i) + 4)
+#define GEN_REPEAT_16(M, x, i) GEN_REPEAT_8(M, x, i)  GEN_REPEAT_8(M, x, (i) + 8)
+#define GEN_REPEAT_32(M, x, i) GEN_REPEAT_16(M, x, i) GEN_REPEAT_16(M, x, (i) + 16)
+#define GEN_REPEAT_64(M, x, i) GEN_REPEAT_32(M, x, i) GEN_REPEAT_32(M, x, (i) + 32)
+#define GEN_REPEAT_10(M, x, i)  GEN_REPEAT_8(M, x, i)  GEN_REPEAT_2(M, x, (i) + 8)
+#define GEN_REPEAT_100(M, x, i) GEN_REPEAT_64(M, x, i) GEN_REPEAT_32(M, x, (i) + 64) GEN_REPEAT_4(M, x, (i) + 96)
+
+#define GEN_REPEAT_UNITS_0(M, x, i)
+#define GEN_REPEAT_UNITS_1(M, x, i) GEN_REPEAT_UNITS_0(M, x, i) GEN_REPEAT_1(M, x, i)
+#define GEN_REPEAT_UNITS_2(M, x, i) GEN_REPEAT_UNITS_1(M, x, i) GEN_REPEAT_1(M, x, (i) + 1)
+#define GEN_REPEAT_UNITS_3(M, x, i) GEN_REPEAT_UNITS_2(M, x, i) GEN_REPEAT_1(M, x, (i) + 2)
+#define GEN_REPEAT_UNITS_4(M, x, i) GEN_REPEAT_UNITS_3(M, x, i) GEN_REPEAT_1(M, x, (i) + 3)
+#define GEN_REPEAT_UNITS_5(M, x, i) GEN_REPEAT_UNITS_4(M, x, i) GEN_REPEAT_1(M, x, (i) + 4)
+#define GEN_REPEAT_UNITS_6(M, x, i) GEN_REPEAT_UNITS_5(M, x, i) GEN_REPEAT_1(M, x, (i) + 5)
+#define GEN_REPEAT_UNITS_7(M, x, i) GEN_REPEAT_UNITS_6(M, x, i) GEN_REPEAT_1(M, x, (i) + 6)
+#define GEN_REPEAT_UNITS_8(M, x, i) GEN_REPEAT_UNITS_7(M, x, i) GEN_REPEAT_1(M, x, (i) + 7)
+#define GEN_REPEAT_UNITS_9(M, x, i) GEN_REPEAT_UNITS_8(M, x, i) GEN_REPEAT_1(M, x, (i) + 8)
+
+#define GEN_REPEAT_TENS_0(M, x, i)
+#define GEN_REPEAT_TENS_1(M, x, i) GEN_REPEAT_TENS_0(M, x, i) GEN_REPEAT_10(M, x, i)
+#define GEN_REPEAT_TENS_2(M, x, i) GEN_REPEAT_TENS_1(M, x, i) GEN_REPEAT_10(M, x, (i) + 10)
+#define GEN_REPEAT_TENS_3(M, x, i) GEN_REPEAT_TENS_2(M, x, i) GEN_REPEAT_10(M, x, (i) + 20)
+#define GEN_REPEAT_TENS_4(M, x, i) GEN_REPEAT_TENS_3(M, x, i) GEN_REPEAT_10(M, x, (i) + 30)
+#define GEN_REPEAT_TENS_5(M, x, i) GEN_REPEAT_TENS_4(M, x, i) GEN_REPEAT_10(M, x, (i) + 40)
+#define GEN_REPEAT_TENS_6(M, x, i) GEN_REPEAT_TENS_5(M, x, i) GEN_REPEAT_10(M, x, (i) + 50)
+#define GEN_REPEAT_TENS_7(M, x, i) GEN_REPEAT_TENS_6(M, x, i) GEN_REPEAT_10(M, x, (i) + 60)
+#define GEN_REPEAT_TENS_8(M, x, i) GEN_REPEAT_TENS_7(M, x, i) GEN_REPEAT_10(M, x, (i) + 70)
+#define GEN_REPEAT_TENS_9(M, x, i) GEN_REPEAT_TENS_8(M, x, i) GEN_REPEAT_10(M, x, (i) + 80)
+
+#define GEN_REPEAT_HUNDREDS_0(M, x, i)
+#define GEN_REPEAT_HUNDREDS_1(M, x, i) GEN_REPEAT_HUNDREDS_0(M, x, i) GEN_REPEAT_100(M, x, i)
+#define GEN_REPEAT_HUNDREDS_2(M, x, i) GEN_REPEAT_HUNDREDS_1(M, x, i) GEN_REPEAT_100(M, x, (i) + 100)
+#define GEN_REPEAT_HUNDREDS_3(M, x, i) GEN_REPEAT_HUNDREDS_2(M, x, i) GEN_REPEAT_100(M, x, (i) + 200)
+#define GEN_REPEAT_HUNDREDS_4(M, x, i) GEN_REPEAT_HUNDREDS_3(M, x, i) GEN_REPEAT_100(M, x, (i) + 300)
+#define GEN_REPEAT_HUNDREDS_5(M, x, i) GEN_REPEAT_HUNDREDS_4(M, x, i) GEN_REPEAT_100(M, x, (i) + 400)
+#define GEN_REPEAT_HUNDREDS_6(M, x, i) GEN_REPEAT_HUNDREDS_5(M, x, i) GEN_REPEAT_100(M, x, (i) + 500)
+#define GEN_REPEAT_HUNDREDS_7(M, x, i) GEN_REPEAT_HUNDREDS_6(M, x, i) GEN_REPEAT_100(M, x, (i) + 600)
+#define GEN_REPEAT_HUNDREDS_8(M, x, i) GEN_REPEAT_HUNDREDS_7(M, x, i) GEN_REPEAT_100(M, x, (i) + 700)
+#define GEN_REPEAT_HUNDREDS_9(M, x, i) GEN_REPEAT_HUNDREDS_8(M, x, i) GEN_REPEAT_100(M, x, (i) + 800)
+#define GEN_REPEAT_HUNDREDS_10(M, x, i) GEN_REPEAT_HUNDREDS_9(M, x, i) GEN_REPEAT_100(M, x, (i) + 900)
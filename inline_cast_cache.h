@@ -0,0 +1,74 @@
+/*
+ * Inline cache for dynamic_cast, for code that cannot register its classes
+ * with a faster cast implementation.
+ *
+ * A cache belongs to one call site. It maps the vtable pointer of the source
+ * object, which identifies its dynamic type, to the result of dynamic_cast
+ * for that type: the pointer adjustment, or failure. With one entry it is a
+ * monomorphic inline cache, with more a polymorphic one (round-robin
+ * replacement). Misses fall back to dynamic_cast.
+ *
+ * Relies on the vtable pointer being at offset 0 of every polymorphic class,
+ * as in the Itanium C++ ABI (GCC, Clang) and MSVC. Objects must not be under
+ * construction or destruction, where the vtable is not the final one.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+template<class To, unsigned int Ways = 1>
+class InlineCastCache {
+    static_assert(std::is_pointer_v<To>, "InlineCastCache<T*>");
+    static_assert(Ways > 0);
+
+public:
+    template<class From>
+    To cast(From* p) {
+        static_assert(std::is_polymorphic_v<From>);
+        if (!p) return nullptr;
+
+        auto vptr = *reinterpret_cast<const void* const*>(p);
+        for (auto& e: entries) {
+            if (e.vptr == vptr) {
+                num_hits++;
+                return e.ok ? reinterpret_cast<To>(reinterpret_cast<char*>(p) + e.offset) : nullptr;
+            }
+        }
+
+        num_misses++;
+        auto result = dynamic_cast<To>(p);
+        auto& e = entries[victim];
+        victim = (victim + 1) % Ways;
+        e.vptr = vptr;
+        e.ok = result != nullptr;
+        e.offset = e.ok ? reinterpret_cast<const char*>(result) - reinterpret_cast<const char*>(p) : 0;
+        return result;
+    }
+
+    uint64_t hits() const { return num_hits; }
+    uint64_t misses() const { return num_misses; }
+    double hit_rate() const { return num_hits + num_misses ? double(num_hits) / (num_hits + num_misses) : 0; }
+    void reset_statistics() { num_hits = num_misses = 0; }
+
+private:
+    struct Entry {
+        const void* vptr { nullptr };
+        std::ptrdiff_t offset { 0 };
+        bool ok { false };
+    };
+
+    Entry entries[Ways];
+    unsigned int victim { 0 };
+    uint64_t num_hits { 0 };
+    uint64_t num_misses { 0 };
+};
+
+// Drop-in replacement for dynamic_cast<To>(p), with a cache of its own, per
+// thread, at every place it is used.
+#define INLINE_CACHED_CAST(Ways, To, p) \
+    ([&] { static thread_local InlineCastCache<To, Ways> inline_cast_cache; return inline_cast_cache.cast(p); }())
@@ -0,0 +1,117 @@
+/*
+ * interval_cast: a downcast that checks class membership with one load and
+ * one range compare, regardless of the depth of the target class.
+ *
+ * The class hierarchy is described once, at compile time, as a tree of
+ * interval::Node<> types. Every class gets its pre-order index in that tree
+ * as type ID, so the IDs of all classes derived from T form the contiguous
+ * range [first, last] computed for T. Each object stores the ID of its
+ * dynamic type, set by calling interval_id(this) in every constructor (just
+ * like priori(this)).
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace interval {
+
+struct Range {
+    uint32_t first;
+    uint32_t last;
+
+    constexpr bool empty() const { return first > last; }
+    constexpr bool contains(uint32_t id) const { return id - first <= last - first; }
+};
+
+constexpr Range no_range { 1, 0 };
+
+// A class T and its direct subclasses. Children are Node<> types themselves.
+// The types only need to be declared, not defined.
+template<class T, class... Children>
+struct Node {
+    static constexpr uint32_t size = 1 + (Children::size + ... + 0);
+
+    // Range of pre-order IDs of U and all its subclasses, if this subtree,
+    // numbered starting at `first`, contains U.
+    template<class U>
+    static constexpr Range find(uint32_t first = 0) {
+        if constexpr (std::is_same_v<U, T>) {
+            return { first, first + size - 1 };
+        } else {
+            Range r = no_range;
+            uint32_t next = first + 1;
+            ((r = r.empty() ? Children::template find<U>(next) : r, next += Children::size), ...);
+            return r;
+        }
+    }
+
+    // Writes the range of every class of this subtree to out[ID].
+    static constexpr void ranges(Range* out, uint32_t first = 0) {
+        out[first] = { first, first + size - 1 };
+        [[maybe_unused]] uint32_t next = first + 1;
+        ((Children::ranges(out, next), next += Children::size), ...);
+    }
+};
+
+template<class Tree>
+class Base {
+public:
+    using interval_tree = Tree;
+
+    uint32_t interval_type_id() const { return type_id; }
+    const uint32_t* interval_type_id_address() const { return &type_id; }
+
+protected:
+    template<class T>
+    void interval_id(T*) {
+        constexpr Range r = Tree::template find<T>();
+        static_assert(!r.empty(), "class is missing from the interval tree");
+        type_id = r.first;
+    }
+
+    // For classes registered at runtime with an ID past the tree (see
+    // type_registry.h). interval_cast does not know such IDs, and only
+    // upcasts these objects.
+    void interval_runtime_id(uint32_t id) { type_id = id; }
+
+private:
+    uint32_t type_id { 0 }; // the root of the tree
+};
+
+template<class T, class Tree>
+constexpr Range range_of = Tree::template find<T>();
+
+// The range of every class of the tree, indexed by type ID.
+template<class Tree>
+std::vector<Range> all_ranges()
+{
+    std::vector<Range> r(Tree::size);
+    Tree::ranges(r.data());
+    return r;
+}
+
+} // namespace interval
+
+template<class To, class From>
+To interval_cast(From* p)
+{
+    using T = std::remove_cv_t<std::remove_pointer_t<To>>;
+    constexpr interval::Range r = interval::range_of<T, typename From::interval_tree>;
+
+    if constexpr (std::is_base_of_v<T, From>) {
+        return p; // upcast
+    } else if constexpr (r.empty()) {
+        return nullptr; // T is not part of the hierarchy
+    } else if constexpr (requires { static_cast<To>(p); }) {
+        return p && r.contains(p->interval_type_id()) ? static_cast<To>(p) : nullptr;
+    } else {
+        // Virtual base: the ID check is still O(1), but the pointer
+        // adjustment has to be looked up at runtime.
+        return p && r.contains(p->interval_type_id()) ? dynamic_cast<To>(p) : nullptr;
+    }
+}
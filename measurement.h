@@ -0,0 +1,131 @@
+/*
+ * Repeated timing of a benchmark pass with summary statistics.
+ *
+ * A measurement runs a few untimed warmup passes (caches, branch predictors
+ * and the CPU frequency governor settle), then times a number of samples.
+ * Timestamps come from the TSC on x86-64, calibrated against steady_clock,
+ * and from steady_clock elsewhere.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+namespace timing {
+
+inline uint64_t now_ticks()
+{
+#if defined(__x86_64__)
+    unsigned int aux;
+    return __rdtscp(&aux);
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Nanoseconds per tick of now_ticks(), measured once.
+inline double ns_per_tick()
+{
+#if defined(__x86_64__)
+    static const double calibrated = [] {
+        auto t1 = std::chrono::steady_clock::now();
+        auto c1 = now_ticks();
+        while (std::chrono::steady_clock::now() - t1 < std::chrono::milliseconds(50));
+        auto c2 = now_ticks();
+        auto t2 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(t2 - t1).count() / double(c2 - c1);
+    }();
+    return calibrated;
+#else
+    return 1.0;
+#endif
+}
+
+// Two-sided 95% quantile of Student's t distribution.
+inline double t_quantile_95(unsigned int degrees_of_freedom)
+{
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+         2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+         2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+    };
+    if (degrees_of_freedom == 0) return INFINITY;
+    if (degrees_of_freedom <= 30) return table[degrees_of_freedom - 1];
+    return 1.96;
+}
+
+// A measurement is unstable if the 95% confidence interval of the mean is
+// wider than ±2% of the median, or if the slowest 1% of samples is more than
+// 10% slower than the fastest.
+const double max_relative_ci = 0.02;
+const double max_relative_spread = 0.10;
+
+struct Measurement {
+    uint64_t successes { 0 };
+    unsigned int samples { 0 };
+    // Duration of one pass, in nanoseconds.
+    double min { 0 };
+    double median { 0 };
+    double p99 { 0 };
+    double stddev { 0 };
+    double ci95 { 0 }; // half-width of the 95% confidence interval of the mean
+
+    bool unstable() const {
+        return ci95 > max_relative_ci * median
+            || p99 - min > max_relative_spread * median;
+    }
+};
+
+// Called around every timed sample, e.g. to enable hardware counters.
+struct NoProbe {
+    void start() {}
+    void stop() {}
+};
+
+template<class Benchmark, class Probe = NoProbe>
+Measurement measure(Benchmark&& benchmark, unsigned int num_warmups, unsigned int num_samples, Probe&& probe = Probe {})
+{
+    Measurement m;
+    for (unsigned int i = 0; i < num_warmups; i++) benchmark();
+
+    std::vector<double> ns(num_samples);
+    for (auto& t: ns) {
+        probe.start();
+        auto c1 = now_ticks();
+        m.successes = benchmark();
+        auto c2 = now_ticks();
+        probe.stop();
+        t = double(c2 - c1) * ns_per_tick();
+    }
+    if (ns.empty()) return m;
+
+    std::sort(ns.begin(), ns.end());
+    auto k = ns.size();
+    double mean = 0;
+    for (auto t: ns) mean += t;
+    mean /= k;
+    double var = 0;
+    for (auto t: ns) var += (t - mean) * (t - mean);
+    var = k > 1 ? var / (k - 1) : 0;
+
+    m.samples = k;
+    m.min = ns.front();
+    m.median = k % 2 ? ns[k / 2] : (ns[k / 2 - 1] + ns[k / 2]) / 2;
+    m.p99 = ns[std::min<size_t>(k - 1, size_t(std::ceil(0.99 * k)) - 1)];
+    m.stddev = std::sqrt(var);
+    m.ci95 = k > 1 ? t_quantile_95(k - 1) * m.stddev / std::sqrt(double(k)) : 0;
+    return m;
+}
+
+} // namespace timing
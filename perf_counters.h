@@ -0,0 +1,131 @@
+/*
+ * Hardware performance counters of the calling thread, via Linux
+ * perf_event_open(2).
+ *
+ * Each counter is opened on its own, so that a PMU which lacks, say, a dTLB
+ * event still provides the others. When perf events are not permitted at all
+ * (no PMU in a VM, perf_event_paranoid, seccomp in containers), available()
+ * is false and the benchmark just omits the counter columns.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace perf {
+
+enum Counter {
+    cycles,
+    instructions,
+    branch_misses,
+    l1d_misses,
+    llc_misses,
+    dtlb_misses,
+    num_counters
+};
+
+const char* const counter_labels[num_counters] = { "cyc", "ins", "brm", "l1d", "llc", "tlb" };
+
+struct Counts {
+    double value[num_counters] {};
+    bool valid[num_counters] {};
+};
+
+class Counters {
+public:
+    Counters() {
+#if defined(__linux__)
+        const uint64_t cache_read_miss =
+            (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        open(cycles,        PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        open(instructions,  PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        open(branch_misses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        open(l1d_misses,    PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D  | cache_read_miss);
+        open(llc_misses,    PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL   | cache_read_miss);
+        open(dtlb_misses,   PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | cache_read_miss);
+#else
+        error = "perf_event_open is Linux only";
+#endif
+    }
+
+    ~Counters() {
+#if defined(__linux__)
+        for (auto fd: fds) if (fd >= 0) close(fd);
+#endif
+    }
+
+    Counters(const Counters&) = delete;
+    Counters& operator=(const Counters&) = delete;
+
+    bool available() const {
+        for (auto fd: fds) if (fd >= 0) return true;
+        return false;
+    }
+
+    // Why no counter could be opened.
+    const std::string& unavailable_reason() const { return error; }
+
+#if defined(__linux__)
+    void reset() { control(PERF_EVENT_IOC_RESET); }
+    void start() { control(PERF_EVENT_IOC_ENABLE); }
+    void stop()  { control(PERF_EVENT_IOC_DISABLE); }
+#else
+    void reset() {}
+    void start() {}
+    void stop()  {}
+#endif
+
+    // Totals since the last reset(), extrapolated if the kernel had to
+    // multiplex the counters.
+    Counts read() const {
+        Counts c;
+#if defined(__linux__)
+        for (int i = 0; i < num_counters; i++) {
+            uint64_t buf[3]; // value, time enabled, time running
+            if (fds[i] < 0 || ::read(fds[i], buf, sizeof(buf)) != sizeof(buf)) continue;
+            c.valid[i] = true;
+            c.value[i] = buf[2] ? double(buf[0]) * double(buf[1]) / double(buf[2]) : 0;
+        }
+#endif
+        return c;
+    }
+
+private:
+#if defined(__linux__)
+    void open(Counter counter, uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = syscall(SYS_perf_event_open, &attr, 0 /* this thread */, -1 /* any cpu */, -1, 0);
+        if (fd < 0 && error.empty()) error = strerror(errno);
+        fds[counter] = fd;
+    }
+
+    void control(unsigned long request) {
+        for (auto fd: fds) if (fd >= 0) ioctl(fd, request, 0);
+    }
+#endif
+
+    int fds[num_counters] { -1, -1, -1, -1, -1, -1 };
+    std::string error;
+};
+
+} // namespace perf
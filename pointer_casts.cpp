@@ -0,0 +1,59 @@
+/*
+ * The shared_ptr casts of the casts suite, in the shared_ptr layouts: to a
+ * shared_ptr that shares ownership, or to a borrowed_ptr that does not count.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+
+template<Implementation I, Ownership O, class... To>
+void run_pointer_cast(std::vector<std::shared_ptr<A>>& v, TypeList<To...>, const std::vector<std::string>& labels)
+{
+    if (!pointer_cast_selected(I)) return;
+
+    printf("Implementation: `%s`\n", pointer_cast_name(I, O));
+    current.implementation = pointer_cast_name(I, O);
+    if constexpr (!available<I>(TypeList<To...> {})) {
+        printf("Not available for this hierarchy.\n\n");
+    } else {
+        if (!validate_pointer_cast<I, O>(v, TypeList<To...> {}, labels)) return;
+
+        auto cast_all = [&]<class T>() -> uint64_t {
+            uint64_t s = 0;
+            for (auto& e: v) { auto p = pointer_cast<I, O, T>(e); p ? s++ : dummy++; }
+            return s;
+        };
+        float sum = 0;
+        unsigned int i = 0;
+        printf("```\n");
+        dummy += run("A", [&] { return cast_all.template operator()<A>(); });
+        ((sum += run(labels[i++], [&] { return cast_all.template operator()<To>(); })), ...);
+        print_average(sum, sizeof...(To));
+        printf("```\n\n");
+    }
+}
+
+template<class... To>
+void run_pointer_cast_implementations(std::vector<std::shared_ptr<A>>& v, TypeList<To...> targets, const std::vector<std::string>& labels)
+{
+    run_pointer_cast<Implementation::dynamic, Ownership::shared>(v, targets, labels);
+    run_pointer_cast<Implementation::priori, Ownership::shared>(v, targets, labels);
+    run_pointer_cast<Implementation::kcl, Ownership::shared>(v, targets, labels);
+    run_pointer_cast<Implementation::interval, Ownership::shared>(v, targets, labels);
+    run_pointer_cast<Implementation::dynamic, Ownership::borrowed>(v, targets, labels);
+    run_pointer_cast<Implementation::priori, Ownership::borrowed>(v, targets, labels);
+    run_pointer_cast<Implementation::kcl, Ownership::borrowed>(v, targets, labels);
+    run_pointer_cast<Implementation::interval, Ownership::borrowed>(v, targets, labels);
+}
+
+void run_pointer_casts(std::vector<std::shared_ptr<A>>& v, Hierarchy h)
+{
+    auto labels = target_labels(h);
+    visit_targets(h, [&](auto targets) { run_pointer_cast_implementations(v, targets, labels); });
+}
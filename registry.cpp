@@ -0,0 +1,227 @@
+/*
+ * Runtime type registry suite: casts with TypeRegistry while one more thread
+ * keeps adding and removing classes, like plugins loaded and unloaded with
+ * dlopen() and dlclose().
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "benchmark.h"
+#include "type_registry.h"
+
+// Classes added at runtime, below A or below each other. The objects only
+// carry the ID; their C++ class is always this one.
+struct Plugin : A {
+    explicit Plugin(TypeRegistry::Type t) { interval_runtime_id(t.id); }
+};
+
+// The registered class of every target, or none for Z.
+template<class... To>
+std::vector<TypeRegistry::Type> registry_targets(const TypeRegistry& registry, TypeList<To...>)
+{
+    return { (std::is_base_of_v<A, To> ? *registry.type(id_of<To>) : TypeRegistry::Type { TypeRegistry::no_id, 0 })... };
+}
+
+template<class To>
+To* registry_cast_to(const TypeRegistry::Reader& reader, A* p, TypeRegistry::Type target)
+{
+    if constexpr (std::is_base_of_v<A, To>) return registry_cast<To*>(reader, p, target);
+    else return nullptr;
+}
+
+// Casts [begin, end) to all targets, and passes a quiescent state every
+// 1024 objects.
+template<class... To, class Ptr>
+uint64_t registry_cast_range(TypeRegistry::Reader& reader, TypeList<To...>, const std::vector<TypeRegistry::Type>& targets,
+        const Ptr* begin, const Ptr* end, uint64_t& failures)
+{
+    uint64_t s = 0, f = 0;
+    unsigned int k = 0;
+    auto cast_to = [&]<class T>() {
+        auto target = targets[k++];
+        for (auto block = begin; block < end; block += 1024) {
+            for (auto e = block; e != std::min(block + 1024, end); ++e) {
+                auto *p = registry_cast_to<T>(reader, ptr(*e), target);
+                p ? s++ : f++;
+            }
+            reader.quiescent();
+        }
+    };
+    (cast_to.template operator()<To>(), ...);
+    failures = f;
+    return s;
+}
+
+template<class To, class Ptr>
+std::string registry_disagreements(const std::vector<Ptr>& v, const TypeRegistry::Reader& reader, TypeRegistry::Type target,
+        const std::string& label)
+{
+    uint64_t num_wrong = 0;
+    size_t first = 0;
+    for (size_t i = 0; i < v.size(); i++) {
+        if (registry_cast_to<To>(reader, ptr(v[i]), target) != dynamic_cast<To*>(ptr(v[i])) && !num_wrong++)
+            first = i;
+    }
+    if (!num_wrong) return "";
+
+    char buffer[512];
+    snprintf(buffer, sizeof buffer, "%3s: WRONG for %lu of %lu objects, first a %s\n",
+            label.c_str(), num_wrong, v.size(), class_name(ptr(v[first])).c_str());
+    return buffer;
+}
+
+// Adds and removes plugin classes, and checks the casts of their objects.
+std::string plugin_disagreements(TypeRegistry& registry)
+{
+    TypeRegistry::Reader reader(registry);
+    std::string errors;
+    auto check = [&](bool ok, const char* what) { if (!ok) errors += std::string(what) + ": WRONG\n"; };
+
+    auto a = *registry.type(id_of<A>);
+    auto b = *registry.type(id_of<deep::B>);
+    auto p1 = *registry.add(a);
+    auto p2 = *registry.add(p1);
+    auto p3 = *registry.add(b);
+    Plugin o2(p2), o3(p3);
+    check(registry_cast<A*>(reader, static_cast<A*>(&o2), a) == &o2, "P2 to A");
+    check(reader.is_a(p2.id, p1), "P2 to P1");
+    check(reader.is_a(p2.id, p2), "P2 to P2");
+    check(!reader.is_a(p2.id, p3), "P2 to P3");
+    check(!registry_cast<deep::B*>(reader, static_cast<A*>(&o2), b), "P2 to B");
+    check(reader.is_a(p3.id, b), "P3 to B");
+    check(!reader.is_a(p3.id, *registry.type(id_of<deep::C>)), "P3 to C");
+    check(!reader.is_a(id_of<deep::B>, p3), "B to P3");
+    check(!registry.remove(p1), "removing P1 before P2");
+    check(!registry.remove(b), "removing B");
+    check(registry.remove(p2), "removing P2");
+    check(!reader.is_a(p2.id, p2) && !reader.is_a(p2.id, a), "removed P2");
+    auto p4 = *registry.add(p3);
+    check(p4.id == p2.id && reader.is_a(p4.id, b) && !reader.is_a(p4.id, p1), "P4 with the ID of P2");
+    check(registry.remove(p4) && registry.remove(p3) && registry.remove(p1), "removing all");
+    return errors;
+}
+
+// Adds plugin classes, each below A or a random one of the others, until
+// max_plugins are registered, and then removes the last one and adds another,
+// until `stop`. Returns the time of each change in ticks.
+std::vector<uint64_t> churn_registry(TypeRegistry& registry, const std::atomic<bool>& stop)
+{
+    std::vector<TypeRegistry::Type> plugins;
+    std::vector<uint64_t> ticks;
+    ticks.reserve(1 << 20);
+    std::minstd_rand random(1);
+    auto root = *registry.type(id_of<A>);
+    while (!stop.load(std::memory_order_relaxed)) {
+        auto c1 = timing::now_ticks();
+        if (plugins.size() < max_plugins) {
+            auto parent = random() % (plugins.size() + 1) == 0 ? root : plugins[random() % plugins.size()];
+            auto t = registry.add(parent);
+            plugins.push_back(t ? *t : *registry.add(root));
+        } else {
+            registry.remove(plugins.back());
+            plugins.pop_back();
+        }
+        ticks.push_back(timing::now_ticks() - c1);
+    }
+    for (auto p = plugins.rbegin(); p != plugins.rend(); ++p) registry.remove(*p);
+    return ticks;
+}
+
+// Casts of v with 1 to hardware_concurrency reader threads, as in
+// measure_scaling, first while no class is added, then while one more thread
+// keeps adding and removing classes.
+template<class... To, class Ptr>
+void run_registry_targets(std::vector<Ptr>& v, TypeList<To...> list, const std::vector<std::string>& labels)
+{
+    TypeRegistry registry(interval::all_ranges<IntervalTree>());
+    auto targets = registry_targets(registry, list);
+
+    std::string errors;
+    {
+        TypeRegistry::Reader reader(registry);
+        errors = registry_disagreements<A>(v, reader, *registry.type(id_of<A>), "A");
+        unsigned int i = 0;
+        ((errors += registry_disagreements<To>(v, reader, targets[i], labels[i]), i++), ...);
+    }
+    errors += plugin_disagreements(registry);
+    if (!errors.empty()) {
+        printf("```\n%s```\n", errors.c_str());
+        printf("Not measured: the results disagree with `dynamic_cast`.\n\n");
+        num_invalid++;
+        return;
+    }
+
+    auto measure = [&](unsigned int num_threads) {
+        std::vector<std::unique_ptr<TypeRegistry::Reader>> readers;
+        for (unsigned int t = 0; t < num_threads; t++) readers.push_back(std::make_unique<TypeRegistry::Reader>(registry));
+        std::vector<uint64_t> failures(num_threads);
+        auto r = measure_threads(num_threads, [&](unsigned int t) {
+            auto begin = v.data() + v.size() * t / num_threads;
+            auto end = v.data() + v.size() * (t + 1) / num_threads;
+            uint64_t f;
+            registry_cast_range(*readers[t], list, targets, begin, end, f);
+            failures[t] += f;
+            return uint64_t(end - begin) * sizeof...(To);
+        });
+        for (auto f: failures) dummy += f;
+        return r;
+    };
+
+    printf("```\n");
+    printf("threads   interval_cast   registry: quiet   adding classes   change   changes/s   change latency: median      p99\n");
+    // The readers run on cores 0, ..., t - 1 and the writer on core t, so
+    // the readers leave one core to the writer.
+    for (unsigned int t = 1; t <= std::max(2u, std::thread::hardware_concurrency()) - 1; t++) {
+        auto baseline = measure_scaling<Implementation::interval, TypeList<To...>>(v, t);
+        auto quiet = measure(t);
+
+        std::atomic<bool> stop { false };
+        std::vector<uint64_t> ticks;
+        uint64_t c1 = 0, c2 = 0;
+        std::thread writer([&] {
+            pin_to_core(t);
+            c1 = timing::now_ticks();
+            ticks = churn_registry(registry, stop);
+            c2 = timing::now_ticks();
+        });
+        auto busy = measure(t);
+        stop = true;
+        writer.join();
+
+        std::sort(ticks.begin(), ticks.end());
+        auto ns = timing::ns_per_tick();
+        auto change = busy.aggregate / quiet.aggregate - 1;
+        printf("%7u: %9.1f MHz   %11.1f MHz   %10.1f MHz   %+5.1f%%   %9.0f   %17.2f us %6.2f us     ",
+                t,
+                baseline.aggregate / num_usecs_per_sec,
+                quiet.aggregate / num_usecs_per_sec,
+                busy.aggregate / num_usecs_per_sec,
+                change * 100,
+                ticks.size() * num_nsecs_per_sec / ((c2 - c1) * ns),
+                ticks.empty() ? NAN : ticks[ticks.size() / 2] * ns / 1e3,
+                ticks.empty() ? NAN : ticks[ticks.size() * 99 / 100] * ns / 1e3);
+        draw_bar(std::max(0.0, busy.aggregate / quiet.aggregate) / 4);
+    }
+    printf("```\n\n");
+}
+
+template<class Ptr>
+void run_registry(std::vector<Ptr>& v, Hierarchy h)
+{
+    auto labels = target_labels(h);
+    visit_targets(h, [&](auto targets) { run_registry_targets(v, targets, labels); });
+}
+
+template void run_registry<std::shared_ptr<A>>(std::vector<std::shared_ptr<A>>&, Hierarchy);
+template void run_registry<A*>(std::vector<A*>&, Hierarchy);
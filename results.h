@@ -0,0 +1,174 @@
+/*
+ * Machine-readable benchmark results, and comparison against a baseline.
+ *
+ * Every measurement becomes one Record, written as CSV (one line per record,
+ * with a header) or as a JSON array. A CSV file of an earlier run can be
+ * read back as the baseline: a record regresses if it is slower than its
+ * baseline by more than the threshold and the 95% confidence intervals of
+ * both do not overlap, so that noise alone does not fail the comparison.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "measurement.h"
+#include "perf_counters.h"
+
+namespace results {
+
+struct Record {
+    // Identifies the measurement across runs of the benchmark.
+    std::string layout;
+    std::string run;
+    std::string hierarchy;
+    std::string data_set;
+    std::string implementation;
+    std::string target;
+
+    double mhz { 0 };
+    uint64_t successes { 0 };
+    unsigned int samples { 0 };
+    // Per cast, in nanoseconds.
+    double median_ns { 0 };
+    double min_ns { 0 };
+    double p99_ns { 0 };
+    double stddev_ns { 0 };
+    double ci95_ns { 0 };
+    bool unstable { false };
+    // Per cast.
+    perf::Counts counters;
+
+    std::string key() const {
+        return layout + "/" + run + "/" + hierarchy + "/" + data_set + "/" + implementation + "/" + target;
+    }
+};
+
+const char* const csv_header =
+    "layout,run,hierarchy,data_set,implementation,target,mhz,successes,samples,"
+    "median_ns,min_ns,p99_ns,stddev_ns,ci95_ns,unstable,cyc,ins,brm,l1d,llc,tlb";
+
+inline bool write_csv(const std::string& path, const std::vector<Record>& records)
+{
+    std::ofstream out(path);
+    out << csv_header << "\n";
+    char buffer[256];
+    for (auto& r: records) {
+        snprintf(buffer, sizeof buffer, "%.3f,%lu,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%d",
+                r.mhz, r.successes, r.samples, r.median_ns, r.min_ns, r.p99_ns, r.stddev_ns, r.ci95_ns, r.unstable);
+        out << r.layout << "," << r.run << "," << r.hierarchy << "," << r.data_set << ","
+            << r.implementation << "," << r.target << "," << buffer;
+        for (int i = 0; i < perf::num_counters; i++) {
+            out << ",";
+            if (r.counters.valid[i]) {
+                snprintf(buffer, sizeof buffer, "%.4f", r.counters.value[i]);
+                out << buffer;
+            }
+        }
+        out << "\n";
+    }
+    return bool(out);
+}
+
+inline bool write_json(const std::string& path, const std::vector<Record>& records)
+{
+    std::ofstream out(path);
+    out << "[\n";
+    char buffer[512];
+    for (size_t k = 0; k < records.size(); k++) {
+        auto& r = records[k];
+        out << "  {\"layout\": \"" << r.layout << "\", \"run\": \"" << r.run
+            << "\", \"hierarchy\": \"" << r.hierarchy << "\", \"data_set\": \"" << r.data_set
+            << "\", \"implementation\": \"" << r.implementation << "\", \"target\": \"" << r.target << "\", ";
+        snprintf(buffer, sizeof buffer,
+                "\"mhz\": %.3f, \"successes\": %lu, \"samples\": %u, \"median_ns\": %.4f, \"min_ns\": %.4f, "
+                "\"p99_ns\": %.4f, \"stddev_ns\": %.4f, \"ci95_ns\": %.4f, \"unstable\": %s, ",
+                r.mhz, r.successes, r.samples, r.median_ns, r.min_ns, r.p99_ns, r.stddev_ns, r.ci95_ns,
+                r.unstable ? "true" : "false");
+        out << buffer << "\"counters\": {";
+        for (int i = 0; i < perf::num_counters; i++) {
+            if (r.counters.valid[i]) snprintf(buffer, sizeof buffer, "%.4f", r.counters.value[i]);
+            else snprintf(buffer, sizeof buffer, "null");
+            out << (i ? ", " : "") << "\"" << perf::counter_labels[i] << "\": " << buffer;
+        }
+        out << "}}" << (k + 1 < records.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+    return bool(out);
+}
+
+// Reads a file written by write_csv(). False if it cannot be opened or is
+// not such a file.
+inline bool read_csv(const std::string& path, std::vector<Record>& records)
+{
+    std::ifstream in(path);
+    std::string line;
+    if (!std::getline(in, line) || line != csv_header) return false;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        std::vector<std::string> f;
+        std::stringstream fields(line);
+        std::string field;
+        while (std::getline(fields, field, ',')) f.push_back(field);
+        if (!line.empty() && line.back() == ',') f.push_back("");
+        if (f.size() != 15 + perf::num_counters) return false;
+
+        Record r;
+        r.layout = f[0];
+        r.run = f[1];
+        r.hierarchy = f[2];
+        r.data_set = f[3];
+        r.implementation = f[4];
+        r.target = f[5];
+        try {
+            r.mhz = std::stod(f[6]);
+            r.successes = std::stoull(f[7]);
+            r.samples = std::stoul(f[8]);
+            r.median_ns = std::stod(f[9]);
+            r.min_ns = std::stod(f[10]);
+            r.p99_ns = std::stod(f[11]);
+            r.stddev_ns = std::stod(f[12]);
+            r.ci95_ns = std::stod(f[13]);
+            for (int i = 0; i < perf::num_counters; i++) {
+                r.counters.valid[i] = !f[15 + i].empty();
+                if (r.counters.valid[i]) r.counters.value[i] = std::stod(f[15 + i]);
+            }
+        } catch (const std::logic_error&) { // invalid_argument, out_of_range
+            return false;
+        }
+        r.unstable = f[14] == "1";
+        records.push_back(r);
+    }
+    return true;
+}
+
+// Relative change of the time per cast, positive if `current` is slower.
+inline double change(const Record& baseline, const Record& current)
+{
+    return current.median_ns / baseline.median_ns - 1;
+}
+
+// Slower by more than `threshold` (e.g. 0.05), outside of both confidence
+// intervals.
+inline bool regressed(const Record& baseline, const Record& current, double threshold)
+{
+    return change(baseline, current) > threshold
+        && current.median_ns - current.ci95_ns > baseline.median_ns + baseline.ci95_ns;
+}
+
+// Faster by more than `threshold`, outside of both confidence intervals.
+inline bool improved(const Record& baseline, const Record& current, double threshold)
+{
+    return change(baseline, current) < -threshold
+        && current.median_ns + current.ci95_ns < baseline.median_ns - baseline.ci95_ns;
+}
+
+} // namespace results
@@ -0,0 +1,96 @@
+/*
+ * Scaling suite: the casts of the casts suite from 1 to hardware_concurrency
+ * threads, each on its own slice of the data set, and the shared_ptr casts
+ * with all threads on the same objects.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "benchmark.h"
+
+template<Implementation I, class Targets, class Ptr>
+void run_scaling(std::vector<Ptr>& v, const std::vector<std::string>& labels)
+{
+    if (!selected(I)) return;
+
+    printf("Implementation: `%s`\n", implementation_name(I));
+    if constexpr (!available<I>(Targets {})) {
+        printf("Not available for this hierarchy.\n\n");
+    } else {
+        if (!validate<I>(v, Targets {}, labels)) return;
+        print_scaling([&](unsigned int t) { return measure_scaling<I, Targets>(v, t); });
+    }
+}
+
+template<class Targets, class Ptr>
+void run_scaling_implementations(std::vector<Ptr>& v, const std::vector<std::string>& labels)
+{
+    run_scaling<Implementation::dynamic, Targets>(v, labels);
+    run_scaling<Implementation::priori, Targets>(v, labels);
+    run_scaling<Implementation::kcl, Targets>(v, labels);
+    run_scaling<Implementation::interval, Targets>(v, labels);
+    run_scaling<Implementation::inline_cache_1, Targets>(v, labels);
+    run_scaling<Implementation::inline_cache_4, Targets>(v, labels);
+}
+
+// Every thread casts all objects of v, so that the threads contend for the
+// same reference counts.
+template<Implementation I, Ownership O, class... To>
+void run_contended_pointer_cast(std::vector<std::shared_ptr<A>>& v, TypeList<To...>, const std::vector<std::string>& labels)
+{
+    if (!pointer_cast_selected(I)) return;
+
+    printf("Implementation: `%s`, all threads on the same objects\n", pointer_cast_name(I, O));
+    if constexpr (!available<I>(TypeList<To...> {})) {
+        printf("Not available for this hierarchy.\n\n");
+    } else {
+        if (!validate_pointer_cast<I, O>(v, TypeList<To...> {}, labels)) return;
+        print_scaling([&](unsigned int num_threads) {
+            std::vector<uint64_t> failures(num_threads);
+            auto r = measure_threads(num_threads, [&](unsigned int t) {
+                uint64_t f = 0;
+                auto cast_all = [&]<class T>() {
+                    for (auto& e: v) { auto p = pointer_cast<I, O, T>(e); if (!p) f++; }
+                };
+                (cast_all.template operator()<To>(), ...);
+                failures[t] += f;
+                return uint64_t(v.size() * sizeof...(To));
+            });
+            for (auto f: failures) dummy += f;
+            return r;
+        });
+    }
+}
+
+template<class Targets>
+void run_contended_pointer_casts(std::vector<std::shared_ptr<A>>& v, const std::vector<std::string>& labels)
+{
+    run_contended_pointer_cast<Implementation::dynamic, Ownership::shared>(v, Targets {}, labels);
+    run_contended_pointer_cast<Implementation::priori, Ownership::shared>(v, Targets {}, labels);
+    run_contended_pointer_cast<Implementation::kcl, Ownership::shared>(v, Targets {}, labels);
+    run_contended_pointer_cast<Implementation::interval, Ownership::shared>(v, Targets {}, labels);
+    run_contended_pointer_cast<Implementation::dynamic, Ownership::borrowed>(v, Targets {}, labels);
+    run_contended_pointer_cast<Implementation::priori, Ownership::borrowed>(v, Targets {}, labels);
+    run_contended_pointer_cast<Implementation::kcl, Ownership::borrowed>(v, Targets {}, labels);
+    run_contended_pointer_cast<Implementation::interval, Ownership::borrowed>(v, Targets {}, labels);
+}
+
+template<class Ptr>
+void run_scaling_benchmarks(std::vector<Ptr>& v, Hierarchy h)
+{
+    auto labels = target_labels(h);
+    visit_targets(h, [&](auto targets) {
+        run_scaling_implementations<decltype(targets)>(v, labels);
+        if constexpr (std::is_same_v<Ptr, std::shared_ptr<A>>)
+            if (pointer_casts) run_contended_pointer_casts<decltype(targets)>(v, labels);
+    });
+}
+
+template void run_scaling_benchmarks<std::shared_ptr<A>>(std::vector<std::shared_ptr<A>>&, Hierarchy);
+template void run_scaling_benchmarks<A*>(std::vector<A*>&, Hierarchy);
@@ -0,0 +1,102 @@
+/*
+ * shared_ptr casts for priori_cast, kcl_dynamic_cast and interval_cast, in
+ * the style of std::dynamic_pointer_cast, and borrowed casts that do not
+ * touch the reference count at all.
+ *
+ * X_pointer_cast<T>(p) returns a shared_ptr<T> that shares ownership with p
+ * (aliasing constructor), or an empty one if the cast fails. Copying p costs
+ * an atomic increment, and its destruction an atomic decrement; the rvalue
+ * overloads take over the reference of p instead, and leave p empty on
+ * success.
+ *
+ * X_borrow_cast<T>(p), also with X = dynamic, returns a borrowed_ptr<T>: a
+ * plain pointer that neither owns nor counts, valid while p or another owner
+ * of the object lives. It cannot be made from a temporary shared_ptr, and
+ * Clang's lifetime analysis warns about some other dangling uses.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "priori/priori.h"
+#include "KCL/KCL_RTTI.h"
+#include "interval_cast.h"
+
+#if defined(__clang__)
+#define SHARED_PTR_CAST_LIFETIMEBOUND [[clang::lifetimebound]]
+#define SHARED_PTR_CAST_POINTER(T) [[gsl::Pointer(T)]]
+#else
+#define SHARED_PTR_CAST_LIFETIMEBOUND
+#define SHARED_PTR_CAST_POINTER(T)
+#endif
+
+template<class T>
+class SHARED_PTR_CAST_POINTER(T) borrowed_ptr {
+public:
+    borrowed_ptr() = default;
+    explicit borrowed_ptr(T* p) : p(p) {}
+
+    T* get() const { return p; }
+    T& operator*() const { return *p; }
+    T* operator->() const { return p; }
+    explicit operator bool() const { return p != nullptr; }
+
+private:
+    T* p { nullptr };
+};
+
+namespace shared_ptr_cast {
+
+template<class T, class U, class Cast>
+std::shared_ptr<T> alias(const std::shared_ptr<U>& p, Cast cast)
+{
+    auto q = cast(p.get());
+    return q ? std::shared_ptr<T>(p, q) : std::shared_ptr<T>();
+}
+
+template<class T, class U, class Cast>
+std::shared_ptr<T> alias(std::shared_ptr<U>&& p, Cast cast)
+{
+    auto q = cast(p.get());
+    return q ? std::shared_ptr<T>(std::move(p), q) : std::shared_ptr<T>();
+}
+
+} // namespace shared_ptr_cast
+
+#define SHARED_PTR_POINTER_CASTS(name, cast) \
+    template<class T, class U> \
+    std::shared_ptr<T> name##_pointer_cast(const std::shared_ptr<U>& p) \
+    { \
+        return shared_ptr_cast::alias<T>(p, [](U* u) { return cast<T*>(u); }); \
+    } \
+    template<class T, class U> \
+    std::shared_ptr<T> name##_pointer_cast(std::shared_ptr<U>&& p) \
+    { \
+        return shared_ptr_cast::alias<T>(std::move(p), [](U* u) { return cast<T*>(u); }); \
+    }
+
+#define SHARED_PTR_BORROW_CAST(name, cast) \
+    template<class T, class U> \
+    borrowed_ptr<T> name##_borrow_cast(const std::shared_ptr<U>& p SHARED_PTR_CAST_LIFETIMEBOUND) \
+    { \
+        return borrowed_ptr<T>(cast<T*>(p.get())); \
+    } \
+    template<class T, class U> \
+    borrowed_ptr<T> name##_borrow_cast(std::shared_ptr<U>&&) = delete;
+
+SHARED_PTR_POINTER_CASTS(priori, priori_cast)
+SHARED_PTR_POINTER_CASTS(kcl, kcl_dynamic_cast)
+SHARED_PTR_POINTER_CASTS(interval, interval_cast)
+
+SHARED_PTR_BORROW_CAST(priori, priori_cast)
+SHARED_PTR_BORROW_CAST(kcl, kcl_dynamic_cast)
+SHARED_PTR_BORROW_CAST(interval, interval_cast)
+SHARED_PTR_BORROW_CAST(dynamic, dynamic_cast)
+
+#undef SHARED_PTR_POINTER_CASTS
+#undef SHARED_PTR_BORROW_CAST
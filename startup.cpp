@@ -0,0 +1,242 @@
+/*
+ * Startup helper of dynamic_cast_benchmark --startup.
+ *
+ * Defines NUM_CLASSES (8, 100 or 1000) classes below a root class, each with
+ * up to 4 subclasses, registered with one cast implementation (CAST, see the
+ * Makefile). With --exit, it only prints the time spent in static
+ * initialization and exits, so that its parent can time the whole process
+ * startup. Otherwise it prints, one "name value" pair per line:
+ *
+ *     static_init_ticks    from the first to the last static initializer
+ *     first_ticks          constructing and destroying one object of every
+ *                          class for the first time, all classes
+ *     construction_ticks   the same again, fastest of 10 passes
+ *     init_heap_bytes      allocated with operator new before main()
+ *     first_heap_bytes     allocated during the first constructions
+ *     image_bytes          size of the loaded executable image
+ *     object_bytes         size of an object of the root class
+ *
+ * Ticks are those of timing::now_ticks(), converted by the parent. Memory is
+ * compared against the build with plain dynamic_cast, which has no registry.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "measurement.h"
+#include "hierarchy_generator.h"
+
+#define CAST_DYNAMIC  0
+#define CAST_PRIORI   1
+#define CAST_KCL      2
+#define CAST_INTERVAL 3
+
+#if !defined(CAST) || !defined(NUM_CLASSES)
+#error "Build with -DCAST=... -DNUM_CLASSES=..., see the Makefile"
+#endif
+
+#if CAST == CAST_PRIORI
+#include "priori/priori.h"
+#elif CAST == CAST_KCL
+#include "KCL/KCL_RTTI.h"
+#elif CAST == CAST_INTERVAL
+#include "interval_cast.h"
+#endif
+
+// Heap allocations through operator new, from the start of the process.
+static uint64_t heap_bytes = 0;
+
+void* operator new(size_t size)
+{
+    heap_bytes += size;
+    if (auto p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+// Before any static initializer without a priority, and the registrations
+// are among those.
+static uint64_t static_init_start;
+__attribute__((constructor(101))) static void start_static_init() { static_init_start = timing::now_ticks(); }
+
+#if defined(__linux__)
+extern "C" char __executable_start, _end;
+#endif
+
+// Class I derives from class (I - 1) / fanout, class 0 from Root.
+constexpr uint32_t fanout = 4;
+constexpr uint32_t parent(uint32_t i) { return (i - 1) / fanout; }
+
+struct Root;
+template<uint32_t I> struct Node;
+
+#if CAST == CAST_INTERVAL
+// Number of classes in the subtree of class i.
+constexpr uint32_t subtree_size(uint32_t i)
+{
+    uint32_t size = 0;
+    for (uint64_t first = i, last = i; first < NUM_CLASSES; first = first * fanout + 1, last = last * fanout + fanout)
+        size += std::min<uint64_t>(last, NUM_CLASSES - 1) - first + 1;
+    return size;
+}
+
+// Pre-order index of class i among the classes.
+constexpr uint32_t preorder(uint32_t i)
+{
+    if (i == 0) return 0;
+    auto index = preorder(parent(i)) + 1;
+    for (auto sibling = fanout * parent(i) + 1; sibling < i; sibling++) index += subtree_size(sibling);
+    return index;
+}
+
+template<class U> struct NodeIndex { static constexpr bool found = false; static constexpr uint32_t value = 0; };
+template<uint32_t I> struct NodeIndex<Node<I>> { static constexpr bool found = true; static constexpr uint32_t value = I; };
+
+// Root and all classes, as an interval::Node tree.
+struct Tree {
+    static constexpr uint32_t size = NUM_CLASSES + 1;
+
+    template<class U>
+    static constexpr interval::Range find(uint32_t first = 0) {
+        if constexpr (std::is_same_v<U, Root>) {
+            return { first, first + size - 1 };
+        } else if constexpr (NodeIndex<U>::found) {
+            auto i = first + 1 + preorder(NodeIndex<U>::value);
+            return { i, i + subtree_size(NodeIndex<U>::value) - 1 };
+        } else {
+            return interval::no_range;
+        }
+    }
+};
+#endif
+
+#if CAST == CAST_PRIORI
+struct Root : priori::Base {
+#elif CAST == CAST_KCL
+struct Root {
+    KCL_RTTI_IMPL();
+#elif CAST == CAST_INTERVAL
+struct Root : interval::Base<Tree> {
+#else
+struct Root {
+#endif
+    virtual ~Root() = default;
+    uint64_t x { 1 };
+};
+#if CAST == CAST_KCL
+KCL_RTTI_REGISTER(Root);
+#endif
+
+template<uint32_t I>
+struct Node : std::conditional_t<I == 0, Root, Node<parent(I)>> {
+    using Parent = std::conditional_t<I == 0, Root, Node<parent(I)>>;
+#if CAST == CAST_PRIORI
+    Node() { this->priori(this); }
+#elif CAST == CAST_KCL
+    KCL_RTTI_IMPL();
+#elif CAST == CAST_INTERVAL
+    Node() { this->interval_id(this); }
+#endif
+};
+
+#if CAST == CAST_KCL
+#define REGISTER_NODE(x, i) KCL_RTTI_REGISTER(Node<i>, Node<i>::Parent);
+#if NUM_CLASSES == 8
+GEN_REPEAT(REGISTER_NODE, _, 0, 0, 8)
+#elif NUM_CLASSES == 100
+GEN_REPEAT(REGISTER_NODE, _, 1, 0, 0)
+#elif NUM_CLASSES == 1000
+GEN_REPEAT(REGISTER_NODE, _, 10, 0, 0)
+#else
+#error "The KCL registrations are written out for 8, 100 and 1000 classes"
+#endif
+#endif
+
+template<class To>
+To* cast(Root* p)
+{
+#if CAST == CAST_PRIORI
+    return priori_cast<To*>(p);
+#elif CAST == CAST_KCL
+    return kcl_dynamic_cast<To*>(p);
+#elif CAST == CAST_INTERVAL
+    return interval_cast<To*>(p);
+#else
+    return dynamic_cast<To*>(p);
+#endif
+}
+
+using Constructor = Root* (*)(void*);
+
+template<uint32_t... I>
+constexpr size_t max_size(std::integer_sequence<uint32_t, I...>) { return std::max({ sizeof(Node<I>)... }); }
+
+template<uint32_t... I>
+constexpr std::array<Constructor, sizeof...(I)> constructors(std::integer_sequence<uint32_t, I...>)
+{
+    return { [](void* p) -> Root* { return new (p) Node<I>; }... };
+}
+
+int main(int argc, char** argv)
+{
+    auto static_init_end = timing::now_ticks();
+    auto init_heap_bytes = heap_bytes;
+    if (argc > 1 && strcmp(argv[1], "--exit") == 0) {
+        printf("static_init_ticks %lu\n", static_init_end - static_init_start);
+        return 0;
+    }
+
+    static constexpr auto classes = std::make_integer_sequence<uint32_t, NUM_CLASSES>();
+    alignas(std::max_align_t) static char buffer[max_size(classes)];
+    const auto all = constructors(classes);
+
+    auto construct_all = [&] {
+        auto c1 = timing::now_ticks();
+        for (auto construct: all) construct(buffer)->~Root();
+        return timing::now_ticks() - c1;
+    };
+
+    auto heap_before = heap_bytes;
+    auto first = construct_all();
+    auto first_heap_bytes = heap_bytes - heap_before;
+    uint64_t fastest = UINT64_MAX;
+    for (int i = 0; i < 10; i++) fastest = std::min(fastest, construct_all());
+
+    // The registry has to agree with dynamic_cast.
+    unsigned int wrong = 0;
+    for (auto construct: all) {
+        auto p = construct(buffer);
+        wrong += cast<Node<0>>(p) != dynamic_cast<Node<0>*>(p);
+        wrong += cast<Node<1>>(p) != dynamic_cast<Node<1>*>(p);
+        wrong += cast<Node<NUM_CLASSES - 1>>(p) != dynamic_cast<Node<NUM_CLASSES - 1>*>(p);
+        p->~Root();
+    }
+    if (wrong > 0) {
+        fprintf(stderr, "%u casts disagree with dynamic_cast\n", wrong);
+        return 1;
+    }
+
+    printf("static_init_ticks %lu\n", static_init_end - static_init_start);
+    printf("first_ticks %lu\n", first);
+    printf("construction_ticks %lu\n", fastest);
+    printf("init_heap_bytes %lu\n", init_heap_bytes);
+    printf("first_heap_bytes %lu\n", first_heap_bytes);
+#if defined(__linux__)
+    printf("image_bytes %lu\n", size_t(&_end - &__executable_start));
+#endif
+    printf("object_bytes %zu\n", sizeof(Root));
+}
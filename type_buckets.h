@@ -0,0 +1,93 @@
+/*
+ * Container that stores objects by value, grouped by their exact dynamic
+ * type, in one contiguous segment per type.
+ *
+ * for_each<T>(f) checks once per segment whether its type derives from T,
+ * with the interval type IDs of interval_cast.h, and then calls f for all
+ * objects of the segment without casting each of them: the T subobject is at
+ * the same offset in every object of a segment.
+ *
+ * Base is the root of the hierarchy, derived from interval::Base. Objects
+ * must not be added while for_each() runs, and references to them are
+ * invalidated by adding more of the same type.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "interval_cast.h"
+
+template<class Base>
+class TypeBuckets {
+public:
+    template<class U, class... Args>
+    U& emplace(Args&&... args) {
+        constexpr interval::Range r = interval::range_of<U, typename Base::interval_tree>;
+        static_assert(!r.empty(), "class is missing from the interval tree");
+
+        if (by_type_id.size() <= r.first) by_type_id.resize(r.first + 1);
+        auto& segment = by_type_id[r.first];
+        if (!segment) {
+            segment = new Bucket<U>;
+            segment->type_id = r.first;
+            segments.emplace_back(segment);
+        }
+        auto bucket = static_cast<Bucket<U>*>(segment);
+        auto& object = bucket->objects.emplace_back(std::forward<Args>(args)...);
+        bucket->size = bucket->objects.size();
+        num_objects++;
+        return object;
+    }
+
+    // Calls f(T&) for every object that is a T, segment by segment.
+    template<class T, class F>
+    void for_each(F&& f) {
+        constexpr interval::Range r = interval::range_of<T, typename Base::interval_tree>;
+        if constexpr (r.empty()) return;
+
+        for (auto& segment: segments) {
+            if (!r.contains(segment->type_id) || segment->size == 0) continue;
+            auto first = reinterpret_cast<char*>(segment->template first_as<T>());
+            for (size_t i = 0; i < segment->size; i++) f(*reinterpret_cast<T*>(first + i * segment->stride));
+        }
+    }
+
+    size_t size() const { return num_objects; }
+    size_t num_segments() const { return segments.size(); }
+
+private:
+    struct Segment {
+        virtual ~Segment() = default;
+        virtual Base* first() = 0;
+
+        // The T subobject of the first object. Only the pointer adjustment
+        // of virtual bases needs dynamic_cast.
+        template<class T>
+        T* first_as() {
+            if constexpr (requires(Base* p) { static_cast<T*>(p); }) return static_cast<T*>(first());
+            else return dynamic_cast<T*>(first());
+        }
+
+        uint32_t type_id { 0 };
+        size_t stride { 0 };
+        size_t size { 0 };
+    };
+
+    template<class U>
+    struct Bucket : Segment {
+        Bucket() { this->stride = sizeof(U); }
+        Base* first() override { return &objects.front(); }
+        std::vector<U> objects;
+    };
+
+    std::vector<std::unique_ptr<Segment>> segments; // in order of first insertion
+    std::vector<Segment*> by_type_id;
+    size_t num_objects { 0 };
+};
@@ -0,0 +1,225 @@
+/*
+ * Type registry that accepts new classes while other threads cast, e.g. the
+ * classes of plugins loaded with dlopen().
+ *
+ * Classes are identified by the type IDs of interval_cast.h. The registry
+ * starts out with the classes of an interval tree, under their pre-order
+ * IDs; classes added at runtime get free IDs past the tree, which their
+ * objects store with interval_runtime_id(). Every class has a display
+ * (Cohen, 1991): the IDs of its base classes from the root down to itself,
+ * unused depths set to no_id. A class derives from T if its display has the
+ * ID of T at the depth of T, so a cast is one compare at any depth.
+ *
+ * Readers never lock or write shared memory while casting. The displays of
+ * all classes are one immutable table: add() and remove() copy it, change
+ * the copy and publish it with one atomic store (read-copy-update). Every
+ * reading thread casts through its own Reader and calls quiescent() now and
+ * then, between casts; a replaced table is freed once every Reader has done
+ * so since (quiescent-state-based reclamation). Writers take a mutex.
+ *
+ * Only single inheritance is modelled, up to max_depth classes deep.
+ *
+ * Part of dynamic_cast_benchmark, MIT License (see LICENSE).
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "interval_cast.h"
+
+class TypeRegistry {
+    struct Slot;
+
+public:
+    static constexpr unsigned int max_depth = 16;
+    static constexpr unsigned int max_readers = 256;
+    static constexpr uint32_t no_id = UINT32_MAX;
+
+    // A registered class, valid until it is removed.
+    struct Type {
+        uint32_t id;
+        uint32_t depth; // 0 for the root
+    };
+
+    // Registers the classes of an interval tree, see interval::all_ranges().
+    explicit TypeRegistry(const std::vector<interval::Range>& ranges) : num_static(ranges.size()) {
+        std::vector<uint32_t> path; // from the root to the current class
+        for (uint32_t id = 0; id < ranges.size(); id++) {
+            while (!path.empty() && !ranges[path.back()].contains(id)) path.pop_back();
+            path.push_back(id);
+            if (path.size() > max_depth) throw std::length_error("TypeRegistry: hierarchy too deep");
+            Display d;
+            d.fill(no_id);
+            std::copy(path.begin(), path.end(), d.begin());
+            current.push_back(d);
+        }
+        table.store(copy_of_current());
+    }
+
+    ~TypeRegistry() {
+        delete[] table.load();
+        for (auto& r: retired) delete[] r.table;
+    }
+
+    TypeRegistry(const TypeRegistry&) = delete;
+    TypeRegistry& operator=(const TypeRegistry&) = delete;
+
+    class Reader {
+    public:
+        explicit Reader(TypeRegistry& registry) : registry(registry) {
+            for (auto& s: registry.slots) {
+                bool unused = false;
+                if (s.used.compare_exchange_strong(unused, true)) {
+                    slot = &s;
+                    break;
+                }
+            }
+            if (!slot) throw std::length_error("TypeRegistry: too many readers");
+            // Seen by a writer that replaces the table after this, or this
+            // reader sees the new table.
+            slot->epoch.store(registry.epoch.load());
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        ~Reader() {
+            slot->epoch.store(0, std::memory_order_release);
+            slot->used.store(false, std::memory_order_release);
+        }
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        // Whether class `id` is T or derived from it.
+        bool is_a(uint32_t id, Type t) const {
+            return registry.table.load(std::memory_order_acquire)[id][t.depth] == t.id;
+        }
+
+        // Tables replaced before this may be freed.
+        void quiescent() {
+            slot->epoch.store(registry.epoch.load(std::memory_order_acquire), std::memory_order_release);
+        }
+
+    private:
+        TypeRegistry& registry;
+        Slot* slot { nullptr };
+    };
+
+    // Adds a class derived from `parent`. None if it would be too deep.
+    std::optional<Type> add(Type parent) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (parent.depth + 1 >= max_depth) return std::nullopt;
+
+        uint32_t id;
+        if (!free_ids.empty()) {
+            id = free_ids.back();
+            free_ids.pop_back();
+        } else {
+            id = current.size();
+            current.emplace_back();
+        }
+        auto& d = current[id];
+        d = current[parent.id];
+        d[parent.depth + 1] = id;
+        publish();
+        return Type { id, parent.depth + 1 };
+    }
+
+    // Removes a class added with add(). It must not have subclasses, and
+    // none of its objects may be cast any more: its ID is reused.
+    bool remove(Type type) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (type.id < num_static || type.id >= current.size() || current[type.id][type.depth] != type.id) return false;
+        if (type.depth + 1 < max_depth)
+            for (auto& d: current)
+                if (d[type.depth] == type.id && d[type.depth + 1] != no_id) return false;
+
+        current[type.id].fill(no_id);
+        free_ids.push_back(type.id);
+        publish();
+        return true;
+    }
+
+    // The class with this ID, if registered.
+    std::optional<Type> type(uint32_t id) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (id >= current.size()) return std::nullopt;
+        for (uint32_t depth = 0; depth < max_depth; depth++)
+            if (current[id][depth] == id) return Type { id, depth };
+        return std::nullopt;
+    }
+
+    // Replaced tables that some reader may still use.
+    size_t num_retired() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return retired.size();
+    }
+
+private:
+    using Display = std::array<uint32_t, max_depth>;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch { 0 }; // last seen, 0 while unused
+        std::atomic<bool> used { false };
+    };
+
+    struct Retired {
+        const Display* table;
+        uint64_t epoch; // of the table that replaced it
+    };
+
+    const Display* copy_of_current() const {
+        auto t = new Display[current.size()];
+        std::copy(current.begin(), current.end(), t);
+        return t;
+    }
+
+    void publish() {
+        auto old = table.exchange(copy_of_current());
+        retired.push_back({ old, epoch.fetch_add(1) + 1 });
+
+        uint64_t oldest = UINT64_MAX;
+        for (auto& s: slots) {
+            auto e = s.epoch.load();
+            if (e != 0) oldest = std::min(oldest, e);
+        }
+        std::erase_if(retired, [&](const Retired& r) {
+            if (r.epoch > oldest) return false;
+            delete[] r.table;
+            return true;
+        });
+    }
+
+    // Read by the readers.
+    std::atomic<const Display*> table { nullptr };
+    std::atomic<uint64_t> epoch { 1 };
+    Slot slots[max_readers];
+
+    // Only used by writers, with the mutex.
+    mutable std::mutex mutex;
+    std::vector<Display> current;
+    std::vector<uint32_t> free_ids;
+    std::vector<Retired> retired;
+    const uint32_t num_static;
+};
+
+// Like interval_cast, with the classes of the registry. To has to be
+// registered as `target`.
+template<class To, class From>
+To registry_cast(const TypeRegistry::Reader& reader, From* p, TypeRegistry::Type target)
+{
+    if constexpr (requires { static_cast<To>(p); }) {
+        return p && reader.is_a(p->interval_type_id(), target) ? static_cast<To>(p) : nullptr;
+    } else {
+        // Virtual base
+        return p && reader.is_a(p->interval_type_id(), target) ? dynamic_cast<To>(p) : nullptr;
+    }
+}